@@ -0,0 +1,22 @@
+#!/bin/sh
+# Porownanie dwoch raportow TSV, zwraca 1 jesli ktoras z metryk pogorszyla sie
+# o wiecej niz THRESHOLD procent.
+# Uzycie: bench/compare.sh STARY NOWY [THRESHOLD]
+OLD=${1:?Usage: $0 OLD NEW [THRESHOLD]}
+NEW=${2:?Usage: $0 OLD NEW [THRESHOLD]}
+awk -F '\t' -v threshold="${3:-10}" '
+	NR == FNR { old[$1 "\t" $2] = $3; next }
+	# liczba rdzeni opisuje maszyne, nie jest metryka wydajnosci
+	$2 == "cpus" { next }
+	($1 "\t" $2) in old && old[$1 "\t" $2] > 0 {
+		change = ($3 - old[$1 "\t" $2]) * 100 / old[$1 "\t" $2]
+		# dla czasow wzrost oznacza pogorszenie
+		if ($2 ~ /_us$/)
+			change = 0 - change
+		flag = change < -threshold ? "REGRESSION" : ""
+		if (flag != "")
+			bad = 1
+		printf "%s\t%s\t%s\t%s\t%+.1f%%\t%s\n", $1, $2, old[$1 "\t" $2], $3, change, flag
+	}
+	END { exit bad }
+' "$OLD" "$NEW"
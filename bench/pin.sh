@@ -0,0 +1,31 @@
+#!/bin/sh
+# Przepustowosc wieloetapowego potoku z przypinaniem etapow do rdzeni i bez.
+# Uzycie: bench/pin.sh SHELL [MB] [POWTORZENIA]
+SHELL_BIN=${1:?Usage: $0 SHELL [MB] [REPEATS]}
+MB=${2:-1024}
+N=${3:-3}
+NAME=$(basename "$SHELL_BIN" .out)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+PIPE="head -c ${MB}M /dev/zero | cat | cat | cat | cat | wc -c"
+echo "$PIPE" > "$TMP/plain.sh"
+echo "pin $PIPE" > "$TMP/pinned.sh"
+
+run() {
+	best=0
+	i=0
+	while [ $i -lt "$N" ]; do
+		start=$(date +%s%N)
+		"$SHELL_BIN" "$TMP/$1.sh" > /dev/null
+		end=$(date +%s%N)
+		rate=$((MB * 1000000000 / (end - start)))
+		[ $rate -gt $best ] && best=$rate
+		i=$((i + 1))
+	done
+	printf '%s\tpipe_%s_mb_per_s\t%s\n' "$NAME" "$1" "$best"
+}
+
+printf '%s\tcpus\t%s\n' "$NAME" "$(nproc)"
+run plain
+run pinned
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Pomiar zimnego startu powloki dla jednoliniowego skryptu.
+# Uzycie: bench/startup.sh SHELL [ITERACJE]
+SHELL_BIN=${1:?Usage: $0 SHELL [ITERATIONS]}
+N=${2:-500}
+NAME=$(basename "$SHELL_BIN" .out)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+# builtin, aby nie mierzyc czasu fork/exec samej komendy
+echo "export BENCH_STARTUP 1" > "$TMP/script.sh"
+
+start=$(date +%s%N)
+i=0
+while [ $i -lt "$N" ]; do
+	"$SHELL_BIN" "$TMP/script.sh"
+	i=$((i + 1))
+done
+end=$(date +%s%N)
+printf '%s\tstartup_wall_us\t%s\n' "$NAME" $(((end - start) / N / 1000))
+
+# czas od wejscia do main do wczytania pierwszej linii, wedlug --profile-startup
+i=0
+while [ $i -lt "$N" ]; do
+	"$SHELL_BIN" --profile-startup "$TMP/script.sh" 2>&1
+	i=$((i + 1))
+done | awk -v name="$NAME" '/startup: read line/ { sum += $(NF - 2); n++ }
+	END { if (n) printf "%s\tstartup_to_first_line_us\t%d\n", name, sum / n * 1000 }'
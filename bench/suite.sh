@@ -0,0 +1,100 @@
+#!/bin/sh
+# Porownanie wydajnosci powloki z lokalnie zainstalowanymi bash oraz dash.
+# Raport w formacie TSV: powloka, metryka, wartosc. Metryki *_per_s - im
+# wiecej tym lepiej, *_us - im mniej tym lepiej.
+# Uzycie: bench/suite.sh SHELL
+SHELL_BIN=${1:?Usage: $0 SHELL}
+CMDS=${BENCH_CMDS:-1000}
+PIPES=${BENCH_PIPES:-200}
+STARTS=${BENCH_STARTS:-300}
+JOBS=${BENCH_JOBS:-200}
+MB=${BENCH_MB:-512}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+now() {
+	date +%s%N
+}
+
+# skrypt z count liniami line
+repeat() {
+	i=0
+	while [ $i -lt "$2" ]; do
+		echo "$1"
+		i=$((i + 1))
+	done > "$3"
+}
+
+pipeline() {
+	line=/bin/true
+	i=1
+	while [ $i -lt "$1" ]; do
+		line="$line | /bin/true"
+		i=$((i + 1))
+	done
+	echo "$line"
+}
+
+report() {
+	printf '%s\t%s\t%s\n' "$NAME" "$1" "$2"
+}
+
+# skrypty wspolne dla wszystkich powlok, tylko skladnia obslugiwana przez
+# kazda z nich (bez >, ktore w grynszpan nie nadpisuje plikow)
+repeat /bin/true "$CMDS" "$TMP/trivial.sh"
+for n in 1 3 8; do
+	repeat "$(pipeline $n)" "$PIPES" "$TMP/pipe$n.sh"
+done
+echo /bin/true > "$TMP/startup.sh"
+echo "head -c ${MB}M /dev/zero | cat | cat >| /dev/null" > "$TMP/pipe_mb.sh"
+head -c "${MB}M" /dev/zero > "$TMP/input"
+echo "cat < $TMP/input >| $TMP/output" > "$TMP/redir_mb.sh"
+repeat "/bin/sleep 0.1 &" "$JOBS" "$TMP/jobs.sh"
+
+bench_shell() {
+	sh_bin=$1
+	NAME=$(basename "$sh_bin" .out)
+
+	start=$(now)
+	"$sh_bin" "$TMP/trivial.sh"
+	end=$(now)
+	report trivial_cmds_per_s $((CMDS * 1000000000 / (end - start)))
+
+	for n in 1 3 8; do
+		start=$(now)
+		"$sh_bin" "$TMP/pipe$n.sh"
+		end=$(now)
+		report "pipeline${n}_launch_us" $(((end - start) / PIPES / 1000))
+	done
+
+	start=$(now)
+	i=0
+	while [ $i -lt "$STARTS" ]; do
+		"$sh_bin" "$TMP/startup.sh"
+		i=$((i + 1))
+	done
+	end=$(now)
+	report script_startup_us $(((end - start) / STARTS / 1000))
+
+	start=$(now)
+	"$sh_bin" "$TMP/pipe_mb.sh"
+	end=$(now)
+	report pipe_mb_per_s $((MB * 1000000000 / (end - start)))
+
+	start=$(now)
+	"$sh_bin" "$TMP/redir_mb.sh"
+	end=$(now)
+	report redirect_mb_per_s $((MB * 1000000000 / (end - start)))
+
+	# zadania w tle dziedzicza stdout, wiec cat konczy sie dopiero po
+	# zakonczeniu ostatniego z nich
+	start=$(now)
+	"$sh_bin" "$TMP/jobs.sh" | cat
+	end=$(now)
+	report async_jobs_us $(((end - start) / 1000))
+}
+
+bench_shell "$SHELL_BIN"
+for other in bash dash; do
+	path=$(command -v $other) && bench_shell "$path"
+done
@@ -0,0 +1,147 @@
+#define _GNU_SOURCE
+#include "affinity.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// kolejnosc rdzeni, w ktorej rdzenie dzielace cache sa obok siebie
+static int cpu_order[CPU_SETSIZE];
+// grupa, do ktorej nalezy rdzen z cpu_order
+static int cpu_domain[CPU_SETSIZE];
+static int cpu_count = -1;
+// poczatki i rozmiary grup rdzeni dzielacych cache w cpu_order
+static int domain_start[CPU_SETSIZE];
+static int domain_size[CPU_SETSIZE];
+static int domain_count = 0;
+// kolejne potoki trafiaja do kolejnych grup
+static int next_domain = 0;
+
+// wczytanie listy rdzeni w formacie "0-3,8,10-11"
+static bool read_cpu_list(const char* path, cpu_set_t* out)
+{
+	FILE* f = fopen(path, "r");
+	if (f == NULL)
+		return false;
+	CPU_ZERO(out);
+	int lo, hi;
+	bool ok = false;
+	while (fscanf(f, "%d", &lo) == 1) {
+		hi = lo;
+		int c = fgetc(f);
+		if (c == '-') {
+			if (fscanf(f, "%d", &hi) != 1)
+				break;
+			c = fgetc(f);
+		}
+		for (int cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; ++cpu)
+			CPU_SET(cpu, out);
+		ok = true;
+		if (c != ',')
+			break;
+	}
+	fclose(f);
+	return ok;
+}
+
+// Rdzenie dzielace z danym rdzeniem najnizszy poziom cache wspolny dla wiecej
+// niz jednego rdzenia (zwykle L2). Grupowanie wedlug najwyzszego poziomu dawaloby
+// na typowym procesorze jedna grupe ze wszystkimi rdzeniami.
+static bool shared_cache(int cpu, cpu_set_t* out)
+{
+	char path[128];
+	int best_level = 0;
+	for (int idx = 0;; ++idx) {
+		snprintf(path, sizeof path,
+			"/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, idx);
+		FILE* f = fopen(path, "r");
+		if (f == NULL)
+			break;
+		int level = 0;
+		if (fscanf(f, "%d", &level) != 1)
+			level = 0;
+		fclose(f);
+		if (level == 0 || (best_level != 0 && level >= best_level))
+			continue;
+		snprintf(path, sizeof path,
+			"/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list",
+			cpu, idx);
+		cpu_set_t tmp;
+		if (read_cpu_list(path, &tmp) && CPU_COUNT(&tmp) > 1) {
+			best_level = level;
+			*out       = tmp;
+		}
+	}
+	return best_level > 0;
+}
+
+// ulozenie dozwolonych rdzeni grupami wspolnego cache
+static void topology_init()
+{
+	cpu_set_t allowed, placed;
+	cpu_count = 0;
+	if (sched_getaffinity(0, sizeof allowed, &allowed) == -1)
+		return;
+	CPU_ZERO(&placed);
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+		if (!CPU_ISSET(cpu, &allowed) || CPU_ISSET(cpu, &placed))
+			continue;
+		cpu_set_t group;
+		if (!shared_cache(cpu, &group)) {
+			CPU_ZERO(&group);
+			CPU_SET(cpu, &group);
+		}
+		domain_start[domain_count] = cpu_count;
+		for (int other = cpu; other < CPU_SETSIZE; ++other) {
+			if (CPU_ISSET(other, &group) && CPU_ISSET(other, &allowed)
+				&& !CPU_ISSET(other, &placed)) {
+				CPU_SET(other, &placed);
+				cpu_domain[cpu_count]  = domain_count;
+				cpu_order[cpu_count++] = other;
+			}
+		}
+		domain_size[domain_count] = cpu_count - domain_start[domain_count];
+		domain_count++;
+	}
+}
+
+bool affinity_assign(int* groups, int stages)
+{
+	if (cpu_count == -1 && stages > 1)
+		topology_init();
+	if (cpu_count < 2 || stages < 2) {
+		for (int i = 0; i < stages; ++i)
+			groups[i] = -1;
+		return false;
+	}
+	// pierwsza grupa, ktora pomiesci caly potok, inaczej kolejna z rzedu
+	int domain = next_domain;
+	for (int i = 0; i < domain_count; ++i) {
+		int d = (next_domain + i) % domain_count;
+		if (domain_size[d] >= stages) {
+			domain = d;
+			break;
+		}
+	}
+	next_domain = (domain + 1) % domain_count;
+	// potok wiekszy od grupy przechodzi na rdzenie kolejnych grup
+	for (int i = 0; i < stages; ++i)
+		groups[i] = cpu_domain[(domain_start[domain] + i) % cpu_count];
+	return true;
+}
+
+void affinity_apply(int group)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int i = 0; i < domain_size[group]; ++i)
+		CPU_SET(cpu_order[domain_start[group] + i], &set);
+	if (sched_setaffinity(0, sizeof set, &set) == -1)
+		perror("sched_setaffinity");
+}
+
+bool affinity_global()
+{
+	const char* env = getenv("GRYNSZPAN_PIN");
+	return env != NULL && env[0] != '\0' && strcmp(env, "0") != 0;
+}
@@ -0,0 +1,18 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+#include <stdbool.h>
+
+// Przydzial grup rdzeni dzielacych najnizszy wspolny poziom cache (wedlug
+// /sys/devices/system/cpu) kolejnym etapom potoku tak, aby sasiednie etapy
+// dzielily cache. Zwraca false jesli przypinanie nie ma sensu (jeden dostepny
+// rdzen lub jeden etap), groups wypelniane sa -1.
+bool affinity_assign(int* groups, int stages);
+
+// ustawienie affinity biezacego procesu na wszystkie rdzenie grupy, procesy
+// wielowatkowe oraz ich potomkowie moga nadal uzywac calej grupy
+void affinity_apply(int group);
+
+// czy przypinanie zostalo wlaczone globalnie zmienna GRYNSZPAN_PIN
+bool affinity_global();
+
+#endif
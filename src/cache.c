@@ -0,0 +1,317 @@
+#define _GNU_SOURCE
+#include "cache.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern const char* progname;
+
+#define CACHE_DEFAULT_MAX_MB 256
+
+// dwa niezalezne 64-bitowe skroty FNV-1a dajace 128-bitowy klucz
+typedef struct hasher {
+	uint64_t a;
+	uint64_t b;
+} hasher;
+
+static void hash_bytes(hasher* h, const void* data, size_t len)
+{
+	const unsigned char* tmp = data;
+	for (size_t i = 0; i < len; ++i) {
+		h->a = (h->a ^ tmp[i]) * 0x100000001b3ULL;
+		h->b = (h->b ^ tmp[i]) * 0x9e3779b97f4a7c15ULL;
+	}
+}
+
+// napisy poprzedzone dlugoscia, aby ("ab","c") i ("a","bc") sie roznily
+static void hash_str(hasher* h, const char* str)
+{
+	size_t len = strlen(str);
+	hash_bytes(h, &len, sizeof len);
+	hash_bytes(h, str, len);
+}
+
+static void hash_stat(hasher* h, const struct stat* st)
+{
+	hash_bytes(h, &st->st_dev, sizeof st->st_dev);
+	hash_bytes(h, &st->st_ino, sizeof st->st_ino);
+	hash_bytes(h, &st->st_size, sizeof st->st_size);
+	hash_bytes(h, &st->st_mtim, sizeof st->st_mtim);
+}
+
+// sciezka wchodzi do klucza zawsze, aby rozne fifo lub brakujace pliki
+// wejsciowe nie dawaly tego samego klucza
+static void hash_file(hasher* h, const char* path)
+{
+	struct stat st;
+	hash_str(h, path);
+	if (stat(path, &st) == -1 || !S_ISREG(st.st_mode))
+		return;
+	hash_stat(h, &st);
+}
+
+// stdin odziedziczone przez powloke, piping() dopuszcza jedynie zwykly plik
+static void hash_stdin(hasher* h)
+{
+	struct stat st;
+	if (fstat(STDIN_FILENO, &st) == -1 || !S_ISREG(st.st_mode))
+		return;
+	// czesc pliku mogla zostac juz odczytana, np. gdy jest to sam skrypt
+	off_t pos = lseek(STDIN_FILENO, 0, SEEK_CUR);
+	hash_stat(h, &st);
+	hash_bytes(h, &pos, sizeof pos);
+}
+
+static uint64_t mix(uint64_t x)
+{
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+}
+
+static int mkdir_parents(char* path)
+{
+	for (char* tmp = path + 1; *tmp != '\0'; ++tmp) {
+		if (*tmp != '/')
+			continue;
+		*tmp = '\0';
+		int res = mkdir(path, 0700);
+		*tmp = '/';
+		if (res == -1 && errno != EEXIST)
+			return -1;
+	}
+	if (mkdir(path, 0700) == -1 && errno != EEXIST)
+		return -1;
+	return 0;
+}
+
+// katalog pamieci podrecznej, tworzony przy pierwszym uzyciu
+static const char* cache_dir()
+{
+	static char dir[PATH_MAX];
+	if (dir[0] != '\0')
+		return dir;
+	const char* env  = getenv("GRYNSZPAN_CACHE_DIR");
+	const char* home = getenv("HOME");
+	if (env != NULL && env[0] != '\0')
+		snprintf(dir, sizeof dir, "%s", env);
+	else if ((env = getenv("XDG_CACHE_HOME")) != NULL && env[0] != '\0')
+		snprintf(dir, sizeof dir, "%s/grynszpan", env);
+	else if (home != NULL)
+		snprintf(dir, sizeof dir, "%s/.cache/grynszpan", home);
+	else
+		return NULL;
+	if (mkdir_parents(dir) == -1) {
+		fprintf(stderr, "%s: cache: %s: %s\n", progname, dir, strerror(errno));
+		dir[0] = '\0';
+		return NULL;
+	}
+	return dir;
+}
+
+bool cache_lookup(const parser_result* in, cache_entry* entry)
+{
+	entry->fd      = -1;
+	entry->path[0] = '\0';
+	const char* dir = cache_dir();
+	if (dir == NULL)
+		return false;
+	hasher h = { 0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL };
+	hash_str(&h, "grynszpan-cache-2");
+	char cwd[PATH_MAX];
+	if (getcwd(cwd, sizeof cwd) != NULL)
+		hash_str(&h, cwd);
+	hash_bytes(&h, &in->cmdlist.size, sizeof in->cmdlist.size);
+	for (int i = 0; i < in->cmdlist.size; ++i) {
+		const shell_cmd* cmd = &in->cmdlist.commands[i];
+		hash_bytes(&h, &cmd->argc, sizeof cmd->argc);
+		for (int j = 0; j < cmd->argc; ++j)
+			hash_str(&h, cmd->argv[j]);
+		// argumenty bedace plikami traktowane sa jako dane wejsciowe
+		for (int j = 1; j < cmd->argc; ++j)
+			hash_file(&h, cmd->argv[j]);
+	}
+	if (in->stdinfile != NULL) {
+		hash_str(&h, "<");
+		hash_file(&h, in->stdinfile);
+	} else {
+		hash_str(&h, "<&0");
+		hash_stdin(&h);
+	}
+	snprintf(entry->path,
+		sizeof entry->path,
+		"%s/%016llx%016llx",
+		dir,
+		(unsigned long long)mix(h.a),
+		(unsigned long long)mix(h.b));
+
+	entry->fd = open(entry->path, O_RDONLY | O_CLOEXEC);
+	if (entry->fd == -1)
+		return false;
+	// czas modyfikacji wpisu sluzy jako czas ostatniego uzycia (LRU)
+	futimens(entry->fd, NULL);
+	return true;
+}
+
+bool cache_begin(cache_entry* entry)
+{
+	if (entry->path[0] == '\0')
+		return false;
+	int len = snprintf(
+		entry->tmp_path, sizeof entry->tmp_path, "%s.XXXXXX", entry->path);
+	if (len >= (int)sizeof entry->tmp_path)
+		return false;
+	entry->fd = mkostemp(entry->tmp_path, O_CLOEXEC);
+	if (entry->fd == -1) {
+		fprintf(stderr,
+			"%s: cache: %s: %s\n",
+			progname,
+			entry->tmp_path,
+			strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+typedef struct cache_file {
+	char name[NAME_MAX + 1];
+	struct timespec mtime;
+	off_t size;
+} cache_file;
+
+static int cache_file_cmp(const void* a, const void* b)
+{
+	const cache_file* x = a;
+	const cache_file* y = b;
+	if (x->mtime.tv_sec != y->mtime.tv_sec)
+		return x->mtime.tv_sec < y->mtime.tv_sec ? -1 : 1;
+	if (x->mtime.tv_nsec != y->mtime.tv_nsec)
+		return x->mtime.tv_nsec < y->mtime.tv_nsec ? -1 : 1;
+	return 0;
+}
+
+// usuniecie najdawniej uzytych wpisow powyzej limitu rozmiaru
+static void cache_evict(const char* dir)
+{
+	const char* env = getenv("GRYNSZPAN_CACHE_MAX");
+	off_t max       = (off_t)(env != NULL ? atoll(env) : CACHE_DEFAULT_MAX_MB)
+		<< 20;
+	DIR* d = opendir(dir);
+	if (d == NULL)
+		return;
+	cache_file* files = NULL;
+	size_t len = 0, cap = 0;
+	off_t total = 0;
+	struct dirent* ent;
+	while ((ent = readdir(d)) != NULL) {
+		struct stat st;
+		// pliki tymczasowe zawieraja kropke
+		if (strchr(ent->d_name, '.') != NULL
+			|| fstatat(dirfd(d), ent->d_name, &st, AT_SYMLINK_NOFOLLOW) == -1
+			|| !S_ISREG(st.st_mode))
+			continue;
+		if (len == cap) {
+			cap   = cap == 0 ? 64 : cap * 2;
+			files = realloc(files, cap * sizeof(cache_file));
+			if (files == NULL) {
+				fprintf(stderr, "Critical error: Malloc failure\n");
+				exit(1);
+			}
+		}
+		snprintf(files[len].name, sizeof files[len].name, "%s", ent->d_name);
+		files[len].mtime = st.st_mtim;
+		files[len].size  = st.st_size;
+		total += st.st_size;
+		len++;
+	}
+	if (total > max) {
+		qsort(files, len, sizeof(cache_file), cache_file_cmp);
+		for (size_t i = 0; i < len && total > max; ++i) {
+			if (unlinkat(dirfd(d), files[i].name, 0) == 0)
+				total -= files[i].size;
+		}
+	}
+	free(files);
+	closedir(d);
+}
+
+void cache_commit(cache_entry* entry, bool ok)
+{
+	// porzucony wpis usuwany jest z katalogu, ale deskryptor pozostaje
+	// otwarty, aby wyjscie potoku moglo zostac odtworzone
+	if (!ok || rename(entry->tmp_path, entry->path) == -1) {
+		unlink(entry->tmp_path);
+		return;
+	}
+	close(entry->fd);
+	entry->fd = open(entry->path, O_RDONLY | O_CLOEXEC);
+	cache_evict(cache_dir());
+}
+
+// kopiowanie w jadrze: reflink, copy_file_range, sendfile, na koncu read/write
+static bool copy_fd(int in, int out, bool whole)
+{
+	struct stat st;
+	if (fstat(in, &st) == -1)
+		return false;
+	if (whole && st.st_size > 0 && ioctl(out, FICLONE, in) == 0)
+		return true;
+	off_t off = 0;
+	while (off < st.st_size) {
+		ssize_t n = copy_file_range(in, &off, out, NULL, st.st_size - off, 0);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+	}
+	while (off < st.st_size) {
+		ssize_t n = sendfile(out, in, &off, st.st_size - off);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+	}
+	char buf[65536];
+	while (off < st.st_size) {
+		ssize_t n = pread(in, buf, sizeof buf, off);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		for (ssize_t done = 0; done < n;) {
+			ssize_t w = write(out, buf + done, n - done);
+			if (w == -1 && errno == EINTR)
+				continue;
+			if (w == -1)
+				return false;
+			done += w;
+		}
+		off += n;
+	}
+	return true;
+}
+
+bool cache_replay(cache_entry* entry, int out_fd, bool whole)
+{
+	if (entry->fd == -1)
+		return false;
+	bool ok = copy_fd(entry->fd, out_fd, whole);
+	if (!ok)
+		fprintf(stderr, "%s: cache: %s: %s\n", progname, entry->path,
+			strerror(errno));
+	close(entry->fd);
+	entry->fd = -1;
+	return ok;
+}
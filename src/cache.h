@@ -0,0 +1,33 @@
+#ifndef CACHE_H
+#define CACHE_H
+#include "parser.h"
+#include <limits.h>
+#include <stdbool.h>
+
+// Pamiec podreczna wynikow potokow poprzedzonych slowem cache. Kluczem jest
+// skrot argumentow wszystkich komend, katalogu roboczego oraz metadanych
+// (urzadzenie, i-wezel, rozmiar, mtime) pliku wejsciowego i argumentow
+// bedacych plikami. Wpisy przechowywane sa w $GRYNSZPAN_CACHE_DIR (domyslnie
+// ~/.cache/grynszpan), a ich laczny rozmiar ograniczony jest przez
+// $GRYNSZPAN_CACHE_MAX w MiB (domyslnie 256), najdawniej uzyte sa usuwane.
+typedef struct cache_entry {
+	char path[PATH_MAX];
+	char tmp_path[PATH_MAX];
+	int fd;
+} cache_entry;
+
+// wyszukanie wyniku potoku, przy trafieniu entry->fd pozwala go odczytac
+bool cache_lookup(const parser_result* in, cache_entry* entry);
+
+// utworzenie tymczasowego pliku na wyjscie potoku (entry->fd)
+bool cache_begin(cache_entry* entry);
+
+// zapisanie wpisu jesli wszystkie etapy potoku zakonczyly sie poprawnie,
+// inaczej porzucenie go, w obu przypadkach entry->fd pozwala odczytac wyjscie
+void cache_commit(cache_entry* entry, bool ok);
+
+// skopiowanie wpisu do out_fd, whole - out_fd to pusty plik otwarty przez
+// powloke, ktorego zawartosc mozna wspoldzielic (reflink)
+bool cache_replay(cache_entry* entry, int out_fd, bool whole);
+
+#endif
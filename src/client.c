@@ -0,0 +1,145 @@
+#include "server.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Cienki klient trybu --server. Celowo nie korzysta z readline ani parsera,
+// aby jego uruchomienie bylo jak najtansze.
+
+static const char* progname;
+
+static void logerr(const char* what)
+{
+	fprintf(stderr, "%s: %s: %s\n", progname, what, strerror(errno));
+	exit(1);
+}
+
+static void write_full(int fd, const void* buf, size_t len)
+{
+	const char* tmp = buf;
+	while (len > 0) {
+		ssize_t n = write(fd, tmp, len);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1)
+			logerr("write");
+		tmp += n;
+		len -= n;
+	}
+}
+
+// wczytanie calego skryptu do pamieci
+static char* read_script(const char* fname, size_t* len)
+{
+	int fd = open(fname, O_RDONLY | O_CLOEXEC);
+	struct stat st;
+	if (fd == -1 || fstat(fd, &st) == -1)
+		logerr(fname);
+	if ((size_t)st.st_size > SERVER_MAX_BODY) {
+		fprintf(stderr, "%s: %s: Script too large\n", progname, fname);
+		exit(1);
+	}
+	char* buf = malloc(st.st_size + 1);
+	if (buf == NULL) {
+		fprintf(stderr, "Critical error: Malloc failure\n");
+		exit(1);
+	}
+	size_t size = 0;
+	while (size < (size_t)st.st_size) {
+		ssize_t n = read(fd, buf + size, st.st_size - size);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1)
+			logerr(fname);
+		if (n == 0)
+			break;
+		size += n;
+	}
+	close(fd);
+	*len = size;
+	return buf;
+}
+
+int main(int argc, char** argv)
+{
+	progname = argv[0];
+	const char* body;
+	char* script = NULL;
+	size_t body_len;
+	if (argc == 4 && strcmp(argv[2], "-c") == 0) {
+		body     = argv[3];
+		body_len = strlen(body);
+	} else if (argc == 3) {
+		script = read_script(argv[2], &body_len);
+		body   = script;
+	} else {
+		fprintf(stderr, "Usage: %s SOCKET FILE\n       %s SOCKET -c LINE\n",
+			progname,
+			progname);
+		return 1;
+	}
+
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	if (strlen(argv[1]) >= sizeof addr.sun_path) {
+		fprintf(stderr, "%s: %s: Socket path too long\n", progname, argv[1]);
+		return 1;
+	}
+	strcpy(addr.sun_path, argv[1]);
+	int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (sock == -1)
+		logerr("socket");
+	if (connect(sock, (struct sockaddr*)&addr, sizeof addr) == -1)
+		logerr(argv[1]);
+
+	char cwd[PATH_MAX];
+	if (getcwd(cwd, sizeof cwd) == NULL)
+		logerr("getcwd");
+
+	server_request req = {
+		.cwd_len  = strlen(cwd),
+		.body_len = body_len,
+	};
+	int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+	union {
+		char buf[CMSG_SPACE(sizeof fds)];
+		struct cmsghdr align;
+	} ctrl;
+	struct iovec iov  = { .iov_base = &req, .iov_len = sizeof req };
+	struct msghdr msg = {
+		.msg_iov        = &iov,
+		.msg_iovlen     = 1,
+		.msg_control    = ctrl.buf,
+		.msg_controllen = sizeof ctrl.buf,
+	};
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level     = SOL_SOCKET;
+	cmsg->cmsg_type      = SCM_RIGHTS;
+	cmsg->cmsg_len       = CMSG_LEN(sizeof fds);
+	memcpy(CMSG_DATA(cmsg), fds, sizeof fds);
+	if (sendmsg(sock, &msg, 0) != sizeof req)
+		logerr("sendmsg");
+	write_full(sock, cwd, req.cwd_len);
+	write_full(sock, body, req.body_len);
+	free(script);
+
+	int32_t status;
+	size_t got = 0;
+	while (got < sizeof status) {
+		ssize_t n = read(sock, (char*)&status + got, sizeof status - got);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			fprintf(stderr, "%s: Server closed connection\n", progname);
+			return 1;
+		}
+		got += n;
+	}
+	return status;
+}
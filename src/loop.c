@@ -0,0 +1,381 @@
+#include "loop.h"
+#include "shell.h"
+#include "vecstring.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// aktualnie wczytywana (najbardziej zagniezdzona) petla
+static loop* pending = NULL;
+
+// powiazanie zmiennej petli z wartoscia w biezacym przebiegu
+typedef struct binding {
+	const char* name;
+	const char* value;
+	const struct binding* next;
+} binding;
+
+static void loop_dealloc(loop* l)
+{
+	for (size_t i = 0; i < l->body_len; ++i) {
+		if (l->body[i].nested != NULL)
+			loop_dealloc(l->body[i].nested);
+		else
+			parser_result_dealloc(&l->body[i].pipeline);
+	}
+	free(l->body);
+	parser_result_dealloc(&l->header);
+	free(l);
+}
+
+// porzucenie calej wczytywanej petli po bledzie skladni
+static void pending_abort()
+{
+	while (pending->parent != NULL)
+		pending = pending->parent;
+	loop_dealloc(pending);
+	pending = NULL;
+}
+
+static void body_push(loop* l, loop_item* item)
+{
+	if (l->body_len == l->body_cap) {
+		l->body_cap = l->body_cap == 0 ? 8 : l->body_cap * 2;
+		l->body     = realloc(l->body, l->body_cap * sizeof(loop_item));
+		if (l->body == NULL) {
+			fprintf(stderr, "Critical error: Malloc failure\n");
+			exit(1);
+		}
+	}
+	l->body[l->body_len++] = *item;
+}
+
+// Podstawienie $name oraz ${name} zmiennymi petli. Zwraca NULL jesli slowo nie
+// zawiera zadnej ze zmiennych, wtedy uzywane jest slowo z szablonu. W slowie
+// zapisanym z backslashami (WORD_ESCAPED) pomijane sa znaki po backslashu, a
+// wartosc zmiennej jest poprzedzana backslashami aby pozostala doslowna.
+static char* expand_word(const char* word, const binding* vars, bool escaped)
+{
+	if (vars == NULL || strchr(word, '$') == NULL)
+		return NULL;
+	string out   = string_init();
+	bool changed = false;
+	for (const char* tmp = word; *tmp != '\0';) {
+		if (escaped && *tmp == '\\' && tmp[1] != '\0') {
+			string_push(&out, *tmp++);
+			string_push(&out, *tmp++);
+			continue;
+		}
+		const char* name = tmp + 1;
+		bool braced      = *name == '{';
+		if (*tmp != '$' || !(isalpha(name[braced]) || name[braced] == '_')) {
+			string_push(&out, *tmp++);
+			continue;
+		}
+		name += braced;
+		size_t len = 0;
+		while (isalnum(name[len]) || name[len] == '_')
+			++len;
+		const binding* var = vars;
+		while (var != NULL
+			&& (strncmp(var->name, name, len) != 0 || var->name[len] != '\0'))
+			var = var->next;
+		if (var == NULL || (braced && name[len] != '}')) {
+			string_push(&out, *tmp++);
+			continue;
+		}
+		for (const char* val = var->value; *val != '\0'; ++val) {
+			if (escaped && strchr("*?[$\\", *val) != NULL)
+				string_push(&out, '\\');
+			string_push(&out, *val);
+		}
+		tmp     = name + len + braced;
+		changed = true;
+	}
+	if (!changed) {
+		string_deinit(&out);
+		return NULL;
+	}
+	return out.buf;
+}
+
+// wykonanie szablonu potoku z podstawionymi zmiennymi petli
+static int run_template_pipeline(
+	parser_result* tmpl, const binding* vars, bool* running)
+{
+	if (vars == NULL)
+		return run_pipeline(tmpl, running);
+	parser_result res     = *tmpl;
+	const cmd_list* cmds  = &tmpl->cmdlist;
+	res.cmdlist.commands  = malloc(cmds->size * sizeof(shell_cmd));
+	for (int i = 0; i < cmds->size; ++i) {
+		const shell_cmd* cmd = &cmds->commands[i];
+		char** argv          = malloc((cmd->argc + 1) * sizeof(char*));
+		for (int j = 0; j < cmd->argc; ++j) {
+			bool escaped = cmd->flags != NULL
+				&& (cmd->flags[j] & WORD_ESCAPED) != 0;
+			char* word = expand_word(cmd->argv[j], vars, escaped);
+			argv[j]    = word != NULL ? word : cmd->argv[j];
+		}
+		argv[cmd->argc]          = NULL;
+		res.cmdlist.commands[i] = (shell_cmd) {
+			.argc  = cmd->argc,
+			.argv  = argv,
+			.flags = cmd->flags,
+		};
+	}
+	if (tmpl->stdinfile != NULL
+		&& (res.stdinfile = expand_word(tmpl->stdinfile, vars, false)) == NULL)
+		res.stdinfile = tmpl->stdinfile;
+	if (tmpl->stdoutfile != NULL
+		&& (res.stdoutfile = expand_word(tmpl->stdoutfile, vars, false)) == NULL)
+		res.stdoutfile = tmpl->stdoutfile;
+
+	int status = run_pipeline(&res, running);
+
+	// zwalniamy jedynie slowa utworzone przez podstawienie
+	for (int i = 0; i < cmds->size; ++i) {
+		for (int j = 0; j < cmds->commands[i].argc; ++j) {
+			if (res.cmdlist.commands[i].argv[j] != cmds->commands[i].argv[j])
+				free(res.cmdlist.commands[i].argv[j]);
+		}
+		free(res.cmdlist.commands[i].argv);
+	}
+	free(res.cmdlist.commands);
+	if (res.stdinfile != tmpl->stdinfile)
+		free(res.stdinfile);
+	if (res.stdoutfile != tmpl->stdoutfile)
+		free(res.stdoutfile);
+	return status;
+}
+
+// wykonanie szablonu listy potokow
+static int run_template(parser_result* tmpl, const binding* vars, bool* running)
+{
+	int status = 0;
+	for (parser_result* it = tmpl; it != NULL && *running;
+		 it              = parser_result_next(it, status))
+		status = run_template_pipeline(it, vars, running);
+	return status;
+}
+
+static bool loop_interrupted()
+{
+	if (sigint_var || sigterm_var) {
+		sigint_var = 0;
+		return true;
+	}
+	return false;
+}
+
+static int loop_exec(loop* l, const binding* vars, bool* running);
+
+static int body_exec(loop* l, const binding* vars, bool* running)
+{
+	int status = 0;
+	for (size_t i = 0; i < l->body_len && *running; ++i) {
+		if (l->body[i].nested != NULL)
+			status = loop_exec(l->body[i].nested, vars, running);
+		else
+			status = run_template(&l->body[i].pipeline, vars, running);
+	}
+	return status;
+}
+
+static int loop_exec(loop* l, const binding* vars, bool* running)
+{
+	int status = 0;
+	if (l->kind == KEYWORD_WHILE) {
+		while (*running && !loop_interrupted()
+			&& run_template(&l->header, vars, running) == 0)
+			status = body_exec(l, vars, running);
+		return status;
+	}
+	const shell_cmd* hdr = l->header.cmdlist.commands;
+	binding var          = { .name = hdr->argv[0], .next = vars };
+	bool stop = false;
+	for (int i = 2; i < hdr->argc && *running && !stop; ++i) {
+		// wzorce w liscie wartosci rozwijane sa przy wejsciu do petli
+		int flags    = hdr->flags != NULL ? hdr->flags[i] : WORD_PLAIN;
+		char* word   = expand_word(hdr->argv[i], vars, flags & WORD_ESCAPED);
+		size_t count;
+		char** values = word_expand(word != NULL ? word : hdr->argv[i], flags,
+			&count);
+		free(word);
+		for (size_t j = 0; j < count && *running; ++j) {
+			if ((stop = loop_interrupted()))
+				break;
+			var.value = values[j];
+			status    = body_exec(l, &var, running);
+		}
+		for (size_t j = 0; j < count; ++j)
+			free(values[j]);
+		free(values);
+	}
+	return status;
+}
+
+// rozpoczecie nowej petli od naglowka for/while
+static bool loop_begin(keyword kind, const char* rest)
+{
+	loop* l = calloc(1, sizeof(loop));
+	if (l == NULL) {
+		fprintf(stderr, "Critical error: Malloc failure\n");
+		exit(1);
+	}
+	l->kind   = kind;
+	l->parent = pending;
+	if (parse_line(&l->header, rest)) {
+		fprintf(stderr,
+			"%s: Expected %s after %s\n",
+			progname,
+			kind == KEYWORD_FOR ? "variable" : "condition",
+			kind == KEYWORD_FOR ? "for" : "while");
+		free(l);
+		return false;
+	}
+	pending = l;
+	if (kind == KEYWORD_FOR) {
+		const parser_result* hdr = &l->header;
+		const shell_cmd* cmd     = hdr->cmdlist.commands;
+		if (hdr->cmdlist.size != 1 || hdr->next != NULL || hdr->stdinfile != NULL
+			|| hdr->stdoutfile != NULL || hdr->is_async || cmd->argc < 2
+			|| strcmp(cmd->argv[1], "in") != 0) {
+			fprintf(stderr, "%s: Expected for NAME in WORDS...\n", progname);
+			return false;
+		}
+	}
+	return true;
+}
+
+// dolaczenie komendy do ciala wczytywanej petli
+static bool loop_push_cmd(const char* segment)
+{
+	loop_item item = { .nested = NULL };
+	if (parse_line(&item.pipeline, segment)) {
+		// pusty segment nie jest bledem
+		while (isspace(*segment))
+			++segment;
+		return *segment == '\0';
+	}
+	body_push(pending, &item);
+	return true;
+}
+
+static bool starts_loop(const char* segment)
+{
+	keyword kw = parse_keyword(&segment);
+	return kw == KEYWORD_FOR || kw == KEYWORD_WHILE;
+}
+
+// obsluga pojedynczego segmentu wczytywanej petli
+static bool loop_segment(const char* segment, bool* running, int* status)
+{
+	keyword kw = parse_keyword(&segment);
+	switch (kw) {
+	case KEYWORD_FOR:
+	case KEYWORD_WHILE:
+		if (pending != NULL && !pending->in_body) {
+			fprintf(stderr, "%s: Expected do\n", progname);
+			return false;
+		}
+		return loop_begin(kw, segment);
+	case KEYWORD_DO:
+		if (pending->in_body) {
+			fprintf(stderr, "%s: Unexpected do\n", progname);
+			return false;
+		}
+		pending->in_body = 1;
+		// petla zagniezdzona moze zaczynac sie zaraz po do
+		if (starts_loop(segment))
+			return loop_segment(segment, running, status);
+		return loop_push_cmd(segment);
+	case KEYWORD_DONE: {
+		if (!pending->in_body || *segment != '\0') {
+			fprintf(stderr, "%s: Unexpected done\n", progname);
+			return false;
+		}
+		loop* l = pending;
+		pending = l->parent;
+		if (pending != NULL) {
+			loop_item item = { .nested = l };
+			body_push(pending, &item);
+			return true;
+		}
+		// petle przerywa jedynie sygnal otrzymany w trakcie jej wykonania
+		sigint_var = 0;
+		*status    = loop_exec(l, NULL, running);
+		loop_dealloc(l);
+		return true;
+	}
+	case KEYWORD_NONE:
+		if (!pending->in_body) {
+			fprintf(stderr, "%s: Expected do\n", progname);
+			return false;
+		}
+		return loop_push_cmd(segment);
+	}
+	return false;
+}
+
+// czy ktorys z kolejnych segmentow linii rozpoczyna petle
+static bool has_loop(const char* line)
+{
+	if (strchr(line, ';') == NULL)
+		return false;
+	bool found = false;
+	char* segment;
+	while (!found && (segment = next_segment(&line)) != NULL) {
+		found = starts_loop(segment);
+		free(segment);
+	}
+	return found;
+}
+
+bool loop_feed(const char* line, bool* running, int* status)
+{
+	*status = -1;
+	if (pending == NULL) {
+		const char* tmp = line;
+		keyword kw      = parse_keyword(&tmp);
+		if (kw == KEYWORD_DO || kw == KEYWORD_DONE) {
+			fprintf(stderr,
+				"%s: Unexpected %s\n",
+				progname,
+				kw == KEYWORD_DO ? "do" : "done");
+			return true;
+		}
+		// linie bez petli wykonywane sa w calosci jako lista potokow
+		if (kw == KEYWORD_NONE && !has_loop(line))
+			return false;
+	}
+	char* segment;
+	while (*running && (segment = next_segment(&line)) != NULL) {
+		bool ok = true;
+		if (pending == NULL && !starts_loop(segment)) {
+			// po zakonczonej petli reszta linii wykonywana jest zwyczajnie
+			int res = run_line(segment, running);
+			if (res != -1)
+				*status = res;
+		} else {
+			ok = loop_segment(segment, running, status);
+		}
+		free(segment);
+		if (!ok) {
+			if (pending != NULL)
+				pending_abort();
+			break;
+		}
+	}
+	return true;
+}
+
+bool loop_eof()
+{
+	if (pending == NULL)
+		return false;
+	fprintf(stderr, "%s: Expected done\n", progname);
+	pending_abort();
+	return true;
+}
@@ -0,0 +1,40 @@
+#ifndef LOOP_H
+#define LOOP_H
+#include "parser.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct loop loop;
+
+// element ciala petli, przetworzony potok lub zagniezdzona petla
+typedef struct loop_item {
+	parser_result pipeline;
+	loop* nested;
+} loop_item;
+
+// Petla for/while. Cialo parsowane jest jednokrotnie, a przy kazdym
+// przebiegu podstawiana jest jedynie wartosc zmiennej petli.
+struct loop {
+	keyword kind;
+	// KEYWORD_FOR: naglowek "x in a b c"
+	// KEYWORD_WHILE: warunek petli
+	parser_result header;
+	loop_item* body;
+	size_t body_len;
+	size_t body_cap;
+	// 0 - oczekiwanie na do, 1 - wczytywanie ciala
+	int in_body;
+	loop* parent;
+};
+
+// Przekazanie linii do petli. Zwraca false jesli linia nie dotyczy petli i
+// powinna zostac wykonana zwyczajnie. Po wczytaniu konczacego done petla jest
+// wykonywana, a jej kod wyjscia zapisywany w status (-1 jesli nic nie
+// wykonano).
+bool loop_feed(const char* line, bool* running, int* status);
+
+// Wywolywane na koncu wejscia. Jesli petla nie zostala zakonczona slowem done,
+// wypisuje blad, porzuca ja i zwraca true.
+bool loop_eof();
+
+#endif
@@ -1,4 +1,9 @@
+#include "affinity.h"
+#include "cache.h"
+#include "loop.h"
 #include "parser.h"
+#include "server.h"
+#include "shell.h"
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
@@ -12,8 +17,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 char curdir[PATH_MAX];
@@ -21,6 +28,33 @@ const char* progname;
 char* prompt = NULL;
 int interactive;
 const char* prompt2 = "$ ";
+// historia wczytywana jest dopiero przy pierwszym uzyciu
+bool history_loaded = false;
+
+// pomiar czasu kolejnych faz startu powloki (--profile-startup)
+static bool profile_startup = false;
+static struct timespec profile_start, profile_last;
+
+static double ms_between(const struct timespec* a, const struct timespec* b)
+{
+	return (b->tv_sec - a->tv_sec) * 1e3 + (b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+// wypisanie czasu od poprzedniej fazy oraz od wejscia do main
+static void profile_phase(const char* name)
+{
+	if (!profile_startup)
+		return;
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	fprintf(stderr,
+		"%s: startup: %-14s %8.3f ms %8.3f ms total\n",
+		progname,
+		name,
+		ms_between(&profile_last, &now),
+		ms_between(&profile_start, &now));
+	profile_last = now;
+}
 
 void logerr()
 {
@@ -32,6 +66,9 @@ typedef struct process_ctx {
 	int stdin_fd;
 	int stdout_fd;
 	int status;
+	pid_t pid;
+	// grupa rdzeni, do ktorej przypinany jest proces, -1 bez przypinania
+	int cpu_group;
 } process_ctx;
 
 // lista procesow, przechowujowca pipe'y i informacje o procesach
@@ -44,7 +81,8 @@ typedef struct process_list {
 // zamkniecie wszystkich pipe'ow
 void p_close(process_list* p_list)
 {
-	for (int i = 0; i < p_list->pipes_len; i++) {
+	// procesow jest o jeden wiecej niz pipe'ow, ostatni moze miec plik wyjscia
+	for (int i = 0; i < p_list->pipes_len + 1; i++) {
 		if (p_list->processes[i].stdout_fd != STDOUT_FILENO)
 			close(p_list->processes[i].stdout_fd);
 		if (p_list->processes[i].stdin_fd != STDIN_FILENO)
@@ -56,6 +94,8 @@ void p_close(process_list* p_list)
 // programu?
 void execute(cmd_list* command_list, process_list* p_list, int current)
 {
+	if (p_list->processes[current].cpu_group >= 0)
+		affinity_apply(p_list->processes[current].cpu_group);
 	dup2(p_list->processes[current].stdout_fd, STDOUT_FILENO);
 	dup2(p_list->processes[current].stdin_fd, STDIN_FILENO);
 	p_close(p_list);
@@ -63,11 +103,12 @@ void execute(cmd_list* command_list, process_list* p_list, int current)
 			command_list->commands[current].argv)
 		== -1) {
 		fprintf(stderr,
-			"%s: %s: execvp failed: %s",
+			"%s: %s: execvp failed: %s\n",
 			progname,
 			command_list->commands[current].argv[0],
 			strerror(errno));
-		exit(errno);
+		// _exit, aby nie oproznic buforow stdio odziedziczonych po powloce
+		_exit(errno);
 	}
 }
 
@@ -85,7 +126,18 @@ pid_t run(cmd_list* commandlist, process_list p_list, int current)
 	}
 }
 
-bool piping(parser_result* in)
+// kod wyjscia procesu w konwencji powlok POSIX
+static int exit_code(int status)
+{
+	if (WIFEXITED(status))
+		return WEXITSTATUS(status);
+	if (WIFSIGNALED(status))
+		return 128 + WTERMSIG(status);
+	return 1;
+}
+
+// zwraca kod wyjscia ostatniej komendy potoku, 0 dla komend asynchronicznych
+int piping(parser_result* in)
 {
 
 	process_list p_list;
@@ -95,6 +147,7 @@ bool piping(parser_result* in)
 	p_list.processes = malloc(sizeof(process_ctx) * in->cmdlist.size);
 
 	// jezeli wczytano nazwe pliku wyjsciowego
+	int out_fd = STDOUT_FILENO;
 	if (in->stdoutfile != NULL) {
 		int perms = O_WRONLY | O_CREAT; // utworzenie zmiennej i przypisanie jej
 										// podstawowych atrybutow
@@ -113,20 +166,53 @@ bool piping(parser_result* in)
 		// W przypadku bledu otwarcia wypisanie bledu i zwolnienie zaalokowanej
 		// pamieci
 		if (fd == -1) {
-			perror(in->stdinfile);
+			perror(in->stdoutfile);
 			free(p_list.pipes);
 			free(p_list.processes);
 			return 1;
 		}
-		p_list.processes[in->cmdlist.size - 1].stdout_fd = fd;
-	} else {
-		p_list.processes[in->cmdlist.size - 1].stdout_fd = STDOUT_FILENO;
+		out_fd = fd;
 	}
 
+	// przy trafieniu w pamieci podrecznej nie uruchamiamy zadnego procesu,
+	// pusty plik otwarty przez powloke moze wspoldzielic dane z wpisem
+	cache_entry entry;
+	bool whole   = in->stdoutfile != NULL && (in->attrib & ATTRIBUTE_APPEND) == 0;
+	bool caching = (in->attrib & ATTRIBUTE_CACHE) != 0 && !in->is_async;
+	// wejscie moze byc czescia klucza jedynie jako zwykly plik, zawartosc
+	// potoku, terminala lub fifo nie jest znana przed uruchomieniem
+	struct stat st;
+	if (caching && in->stdinfile == NULL)
+		caching = fstat(STDIN_FILENO, &st) == 0 && S_ISREG(st.st_mode);
+	else if (caching && stat(in->stdinfile, &st) == 0)
+		caching = S_ISREG(st.st_mode);
+	if (caching && cache_lookup(in, &entry)) {
+		int ret = cache_replay(&entry, out_fd, whole) ? 0 : 1;
+		if (out_fd != STDOUT_FILENO)
+			close(out_fd);
+		free(p_list.pipes);
+		free(p_list.processes);
+		return ret;
+	}
+	// wyjscie potoku trafia do wpisu, a po zakonczeniu kopiowane jest do
+	// out_fd, zamykanego wtedy przez nas zamiast p_close
+	caching = caching && cache_begin(&entry);
+	p_list.processes[in->cmdlist.size - 1].stdout_fd
+		= caching ? dup(entry.fd) : out_fd;
+
 	if (in->stdinfile != NULL) { // jezeli wczytano nazwe pliku wejsciowego
 		int fd = open(in->stdinfile, O_RDONLY, 0666);
 		if (fd == -1) {
 			perror(in->stdinfile);
+			if (p_list.processes[in->cmdlist.size - 1].stdout_fd
+				!= STDOUT_FILENO)
+				close(p_list.processes[in->cmdlist.size - 1].stdout_fd);
+			if (caching) {
+				cache_commit(&entry, false);
+				close(entry.fd);
+				if (out_fd != STDOUT_FILENO)
+					close(out_fd);
+			}
 			free(p_list.pipes);
 			free(p_list.processes);
 			return 1;
@@ -136,30 +222,66 @@ bool piping(parser_result* in)
 		p_list.processes[0].stdin_fd = STDIN_FILENO;
 	}
 
+	// pojedyncza komenda nie ma sasiada, z ktorym dzielilaby cache
+	int* groups = malloc(sizeof(int) * in->cmdlist.size);
+	if (in->cmdlist.size == 1
+		|| ((in->attrib & ATTRIBUTE_PIN) == 0 && !affinity_global()))
+		for (int i = 0; i < in->cmdlist.size; ++i)
+			groups[i] = -1;
+	else
+		affinity_assign(groups, in->cmdlist.size);
+	for (int i = 0; i < in->cmdlist.size; ++i)
+		p_list.processes[i].cpu_group = groups[i];
+	free(groups);
+
 	for (int i = 1; i < in->cmdlist.size; ++i) {
 		pipe(p_list.pipes[i - 1]);
 		p_list.processes[i].stdin_fd      = p_list.pipes[i - 1][0];
 		p_list.processes[i - 1].stdout_fd = p_list.pipes[i - 1][1];
 	}
 
+	// SIGCHLD blokowany przed fork, inaczej handler moglby odebrac status
+	// procesu zanim zdazymy na niego poczekac
+	sigset_t blockchld, oldmask;
+	sigemptyset(&blockchld);
+	sigaddset(&blockchld, SIGCHLD);
+	if (!in->is_async)
+		sigprocmask(SIG_BLOCK, &blockchld, &oldmask);
+
 	for (int i = 0; i < in->cmdlist.size; ++i) {
-		run(&in->cmdlist, p_list, i);
+		p_list.processes[i].pid = run(&in->cmdlist, p_list, i);
+		if (p_list.processes[i].pid == -1)
+			perror(progname);
 	}
 	p_close(&p_list);
 
+	int ret      = 0;
+	bool success = !in->is_async;
 	if (!in->is_async) {
-		sigset_t blockchld, oldmask;
-		sigemptyset(&blockchld);
-		sigaddset(&blockchld, SIGCHLD);
-		sigprocmask(SIG_BLOCK, &blockchld, &oldmask);
-
-		while (wait(NULL) > 0 || errno == EINTR)
-			;
-		sigprocmask(SIG_UNBLOCK, &blockchld, &oldmask);
+		for (int i = 0; i < in->cmdlist.size; ++i) {
+			process_ctx* proc = &p_list.processes[i];
+			proc->status      = 1 << 8;
+			if (proc->pid == -1)
+				continue;
+			while (waitpid(proc->pid, &proc->status, 0) == -1 && errno == EINTR)
+				;
+			success = success && exit_code(proc->status) == 0;
+		}
+		ret = exit_code(p_list.processes[in->cmdlist.size - 1].status);
+		sigprocmask(SIG_SETMASK, &oldmask, NULL);
+	}
+	// zapamietywany jest jedynie wynik potoku, ktorego wszystkie etapy
+	// zakonczyly sie kodem 0, wyjscie pozostalych jest jedynie przekazywane
+	if (caching) {
+		cache_commit(&entry, success);
+		if (!cache_replay(&entry, out_fd, whole) && ret == 0)
+			ret = 1;
+		if (out_fd != STDOUT_FILENO)
+			close(out_fd);
 	}
 	free(p_list.pipes);
 	free(p_list.processes);
-	return 0;
+	return ret;
 }
 // inicjalizacja promptu
 int prompt_init(char** prompt)
@@ -214,9 +336,21 @@ enum builtin detect_builtin(shell_cmd* in)
 	return BUILTIN_NONE;
 }
 
+// wczytanie historii z pliku, jedynie w trybie interaktywnym
+void history_init()
+{
+	if (history_loaded || !interactive)
+		return;
+	history_loaded = true;
+	stifle_history(20);
+	read_history(NULL);
+	profile_phase("history");
+}
+
 // funkcja do wypisania historii komend
 void print_history()
 {
+	history_init();
 	HIST_ENTRY** his = history_list();
 	if (his == NULL)
 		return;
@@ -226,19 +360,23 @@ void print_history()
 	}
 }
 
-// obsluga flag i bledow
-void handle_builtin(const shell_cmd* cmd, enum builtin in)
+// obsluga flag i bledow, zwraca kod wyjscia komendy wbudowanej
+int handle_builtin(const shell_cmd* cmd, enum builtin in)
 {
+	int status = 0;
 	switch (in) {
 	case BUILTIN_CD:
 		if (cmd->argc != 2) {
 			printf("cd: Expected single argument\n");
+			status = 1;
 			break;
 		}
-		if (chdir(cmd->argv[1]) == 0)
+		if (chdir(cmd->argv[1]) == 0) {
 			set_cwd();
-		else
+		} else {
 			fprintf(stderr, "cd: %s: %s\n", cmd->argv[1], strerror(errno));
+			status = 1;
+		}
 		break;
 	case BUILTIN_HISTORY:
 		print_history();
@@ -246,6 +384,7 @@ void handle_builtin(const shell_cmd* cmd, enum builtin in)
 	case BUILTIN_EXPORT: {
 		if (cmd->argc < 3) {
 			printf("export: Expected at least 2 arguments\n");
+			status = 1;
 			break;
 		}
 		int overwrite = 0;
@@ -253,6 +392,7 @@ void handle_builtin(const shell_cmd* cmd, enum builtin in)
 		if (strcmp(cmd->argv[1], "-o") == 0) {
 			if (cmd->argc != 4) {
 				printf("export: Expected 2 arguments\n");
+				status = 1;
 				break;
 			}
 			overwrite = 1;
@@ -264,21 +404,25 @@ void handle_builtin(const shell_cmd* cmd, enum builtin in)
 		}
 		if (setenv(in, out, overwrite) == -1) {
 			perror("export");
+			status = 1;
 		}
 	} break;
 	case BUILTIN_UNEXPORT:
 		if (cmd->argc != 2) {
 			printf("unexport: Expected 1 argument\n");
+			status = 1;
 			break;
 		}
 		if (unsetenv(cmd->argv[1]) == -1) {
 			perror("unexport");
+			status = 1;
 		}
 		break;
 	case BUILTIN_EXIT:
 	case BUILTIN_NONE:
 		break;
 	}
+	return status;
 }
 
 atomic_int sigint_var, sigquit_var, sigterm_var;
@@ -302,6 +446,21 @@ void sig_handler(int id)
 	}
 }
 
+void handle_sigterm()
+{
+	if (history_loaded) {
+		write_history(NULL);
+		clear_history();
+	}
+	fprintf(stderr, "%s: Caught SIGTERM\n", progname);
+	if (kill(0, SIGTERM) == -1) {
+		fprintf(stderr,
+			"%s: Couldn't send SIGTERM to child processes\n",
+			progname);
+	}
+	exit(1);
+}
+
 int signal_hook()
 {
 	int reset = 0;
@@ -317,15 +476,7 @@ int signal_hook()
 		print_history();
 	}
 	if (sigterm_var) {
-		write_history(NULL);
-		clear_history();
-		fprintf(stderr, "%s: Caught SIGTERM\n", progname);
-		if (kill(0, SIGTERM) == -1) {
-			fprintf(stderr,
-				"%s: Couldn't send SIGTERM to child processes\n",
-				progname);
-		}
-		exit(1);
+		handle_sigterm();
 	}
 	if (reset) {
 		rl_free_line_state();
@@ -355,100 +506,205 @@ void wait_for_all_child()
 		;
 }
 
-void handle_noninteractive(const char* fname)
+// readline wraz z historia konfigurowany jest dopiero przed pierwszym
+// wczytaniem linii w trybie interaktywnym, skrypty czytane sa bez niego
+void readline_init()
 {
-	prompt2 = NULL;
-	rl_tty_set_echoing(0);
-	FILE* f = fopen("/dev/null","w");
-	if (f != NULL)
-		rl_outstream = f;
-
-	if (fname == NULL)
+	static bool initialized = false;
+	if (initialized)
 		return;
-	rl_instream = fopen(fname,"r");
+	initialized = true;
+	rl_clear_signals();
+	rl_catch_signals     = 0;
+	rl_signal_event_hook = signal_hook;
+	profile_phase("readline");
+	// historia poprzedniej sesji dostepna juz przy pierwszym prompcie
+	history_init();
 }
 
-void handle_interactive()
+// ustawienie katalogu roboczego i wczytanie promptu przy pierwszym wypisaniu
+void prompt_print()
 {
-	// ustawienie katalogu roboczego i wczytanie promptu
-	set_cwd();
-	if (prompt_init(&prompt) < 0) {
-		perror(progname);
-		exit(1);
+	if (prompt == NULL) {
+		set_cwd();
+		if (prompt_init(&prompt) < 0) {
+			perror(progname);
+			exit(1);
+		}
+		profile_phase("prompt");
 	}
-	read_history(NULL);
+	printf(prompt, curdir);
+}
+
+// wczytanie kolejnej linii bez znaku nowej linii, NULL na koncu wejscia
+char* next_line(FILE* script)
+{
+	if (interactive) {
+		readline_init();
+		prompt_print();
+		return readline(prompt2);
+	}
+	char* buf   = NULL;
+	size_t cap  = 0;
+	size_t size = 0;
+	for (;;) {
+		if (sigterm_var)
+			handle_sigterm();
+		// po przerwaniu reszta linii wczytywana jest do osobnego bufora
+		char* part  = NULL;
+		size_t pcap = 0;
+		ssize_t len = size == 0 ? getline(&buf, &cap, script)
+								: getline(&part, &pcap, script);
+		if (len > 0 && size > 0) {
+			buf = realloc(buf, size + len + 1);
+			if (buf == NULL) {
+				fprintf(stderr, "Critical error: Malloc failure\n");
+				exit(1);
+			}
+			memcpy(buf + size, part, len + 1);
+		}
+		free(part);
+		if (len > 0)
+			size += len;
+		if (size > 0 && buf[size - 1] == '\n')
+			break;
+		// odczyt przerwany sygnalem, linia jest czytana dalej
+		if (ferror(script) && errno == EINTR) {
+			clearerr(script);
+			continue;
+		}
+		break;
+	}
+	if (size == 0) {
+		free(buf);
+		return NULL;
+	}
+	if (buf[size - 1] == '\n')
+		buf[size - 1] = '\0';
+	return buf;
+}
+
+// przetworzenie i wykonanie pojedynczej linii, zwraca kod wyjscia lub -1 gdy
+// linia byla pusta badz niepoprawna
+int run_line(const char* line, bool* running)
+{
+	int status;
+	if (loop_feed(line, running, &status))
+		return status;
+	parser_result pars;
+	if (parse_line(&pars, line))
+		return -1;
+	status = run_parsed(&pars, running);
+	parser_result_dealloc(&pars);
+	return status;
+}
+
+int run_pipeline(parser_result* pars, bool* running)
+{
+	// wzorce rozwijane sa dopiero teraz, po wykonaniu poprzednich potokow
+	parser_result expanded;
+	if (parser_result_expand(&expanded, pars)) {
+		int status = run_pipeline(&expanded, running);
+		parser_result_dealloc(&expanded);
+		return status;
+	}
+	enum builtin tmp = detect_builtin(pars->cmdlist.commands);
+	if (tmp == BUILTIN_EXIT)
+		*running = false;
+	else if (tmp == BUILTIN_NONE)
+		return piping(pars);
+	else
+		return handle_builtin(pars->cmdlist.commands, tmp);
+	return 0;
+}
+
+// wykonanie listy potokow, && oraz || pomijaja potoki wedlug kodu wyjscia
+int run_parsed(parser_result* pars, bool* running)
+{
+	int status = 0;
+	for (parser_result* it = pars; it != NULL && *running;
+		 it              = parser_result_next(it, status))
+		status = run_pipeline(it, running);
+	return status;
 }
 
 int main(int argc, char** argv)
 {
-	progname = argv[0];
-	if (argc == 1) {
-		// w przypadku braku argumentow jest mozliwosc
-		// ze stdin to nie terminal a plik (przekierowanie)
-		if (isatty(STDIN_FILENO)) {
-			interactive = 1;
-			handle_interactive();
+	clock_gettime(CLOCK_MONOTONIC, &profile_start);
+	profile_last = profile_start;
+	progname     = argv[0];
+	int argi     = 1;
+	for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; ++argi) {
+		if (strcmp(argv[argi], "--profile-startup") == 0) {
+			profile_startup = true;
+		} else if (strcmp(argv[argi], "--server") == 0 && argi + 1 < argc) {
+			signal(SIGCHLD, sig_handler);
+			return server_run(argv[argi + 1]);
 		} else {
-			interactive = 0;
-			handle_noninteractive(NULL);
+			fprintf(stderr,
+				"Usage: %s [--profile-startup] [FILE]\n"
+				"       %s --server SOCKET\n",
+				progname,
+				progname);
+			return 1;
 		}
-	} else {
-		// w przypadku nieinteraktywnym przekierowujemy stdin na plik
-		interactive = 0;
-		handle_noninteractive(argv[1]);
 	}
-	signal(SIGINT, sig_handler);
-	signal(SIGTERM, sig_handler);
+	// bez SA_RESTART, aby sygnal przerwal oczekiwanie na linie skryptu
+	struct sigaction sa = { .sa_handler = sig_handler };
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
 	signal(SIGQUIT, sig_handler);
 	signal(SIGCHLD, sig_handler);
-	stifle_history(20);
-	rl_clear_signals();
-	rl_catch_signals = 0;
-	rl_signal_event_hook = signal_hook;
+	profile_phase("signals");
+
+	FILE* script = stdin;
+	if (argi < argc) {
+		// w przypadku nieinteraktywnym czytamy komendy z pliku
+		interactive = 0;
+		script      = fopen(argv[argi], "r");
+		if (script == NULL) {
+			fprintf(stderr, "%s: %s: %s\n", progname, argv[argi], strerror(errno));
+			return 1;
+		}
+	} else {
+		// w przypadku braku argumentow jest mozliwosc
+		// ze stdin to nie terminal a plik (przekierowanie)
+		interactive = isatty(STDIN_FILENO);
+	}
+	profile_phase("input");
 
 	// utworzenie i ustawienie warunku running na tru, zmienia sie na false przy
 	// wpisaniu exit
 	bool running = true;
 	while (running) {
-		if (interactive)
-			printf(prompt, curdir);
-		char* buf = readline(prompt2);
+		char* buf = next_line(script);
 		if (buf == NULL) {
 			break;
 		}
-		parser_result pars;
+		profile_phase("read line");
 		// wczytanie linii, przetworzenie jej i odpowiednio obsluga bledow lub
 		// wykonanie polecenia
-		int res = parse_line(&pars, buf);
-		if (res) {
-			goto rl_cleanup;
+		if (run_line(buf, &running) != -1) {
+			if (interactive)
+				add_history(buf);
+			// pomiar konczy sie na pierwszej wykonanej komendzie
+			profile_phase("first command");
+			profile_startup = false;
 		}
-		enum builtin tmp = detect_builtin(pars.cmdlist.commands);
-		if (tmp == BUILTIN_EXIT)
-			running = false;
-		else if (tmp == BUILTIN_NONE)
-			piping(&pars);
-		else
-			handle_builtin(pars.cmdlist.commands, tmp);
-
-		// wypisanie zadanego polecenia oraz zwolnienie pamieci bufora i
-		// przetworzonej linii
-		parser_result_dealloc(&pars);
-		if (interactive) {
-			add_history(buf);
-		}
-	rl_cleanup:
 		free(buf);
 	}
+	int status = 0;
+	if (loop_eof())
+		status = 1;
 	// dealloc resources
-	if (interactive) {
+	if (history_loaded) {
 		write_history(NULL);
 		clear_history();
 	}
 	free(prompt);
-	if (!interactive) {
-		fclose(rl_instream);
-		fclose(rl_outstream);
-	}
+	if (script != stdin)
+		fclose(script);
 	wait_for_all_child();
+	return status;
 }
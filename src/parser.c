@@ -1,6 +1,7 @@
 #include "parser.h"
 #include "vec.h"
 #include "vecstring.h"
+#include "wildcard.h"
 #include <ctype.h>
 #include <fcntl.h>
 #include <stdio.h>
@@ -12,6 +13,8 @@ VEC_DECLARE(vec_string, char*);
 
 VEC_DECLARE(vec_cmds, shell_cmd);
 
+VEC_DECLARE(vec_flags, unsigned char);
+
 extern const char* progname;
 
 enum stop_reason {
@@ -38,11 +41,13 @@ static const char* skip_ws(const char* in)
 	return in;
 }
 
-static int push_word(string* str, const char** line)
+// glob ustawiany gdy slowo zawiera niecytowane znaki wzorca * ? [
+static int push_word(string* str, const char** line, int* glob)
 {
 	int state_dq    = 0;
 	int state_bcksl = 0;
 	const char* tmp = *line;
+	*glob           = 0;
 	if (*tmp == '\0')
 		return END_OF_LINE;
 	for (char c; (c = *tmp) != '\0'; ++tmp) {
@@ -61,16 +66,48 @@ static int push_word(string* str, const char** line)
 		if (state_bcksl == 1) {
 			string_push(str, c);
 			state_bcksl = 0;
-		} else if (state_dq == 0 && isspace(c)) {
+		} else if (state_dq == 0 && (isspace(c) || strchr(";&|<>", c) != NULL)) {
+			// operatory i przekierowania koncza slowo rowniez bez
+			// poprzedzajacej spacji
 			*line = tmp;
 			return WHITESPACE;
 		} else {
+			if (state_dq == 0
+				&& (c == '*' || c == '?' || (c == '[' && strchr(tmp, ']'))))
+				*glob = 1;
 			string_push(str, c);
 		}
 	}
 	*line = tmp;
 	return END_OF_LINE;
 }
+// postac slowa rozwijanego przy wykonaniu, znaki w cudzyslowie lub po
+// backslashu sa poprzedzane backslashem aby nie byly traktowane jako wzorzec
+// ani zmienna petli
+static string glob_pattern(const char* raw, const char* end)
+{
+	string pat      = string_init();
+	int state_dq    = 0;
+	int state_bcksl = 0;
+	for (; raw != end; ++raw) {
+		char c = *raw;
+		if (state_bcksl == 1) {
+			string_push(&pat, '\\');
+			string_push(&pat, c);
+			state_bcksl = 0;
+		} else if (c == '\\' && state_dq == 0) {
+			state_bcksl = 1;
+		} else if (c == '"') {
+			state_dq = !state_dq;
+		} else {
+			if (state_dq == 1 && strchr("*?[$\\", c) != NULL)
+				string_push(&pat, '\\');
+			string_push(&pat, c);
+		}
+	}
+	return pat;
+}
+
 // ustawianie flag w zaleznosci od wczytanych symboli
 static cmd_attributes parse_symbol(const char** in)
 {
@@ -108,30 +145,103 @@ static cmd_attributes parse_symbol(const char** in)
 	return flags;
 }
 
-void cleanup_vecs(vec_cmds* in1, vec_string* in2, string* in3)
+// slowa pin oraz cache na poczatku potoku, kazde moze wystapic raz
+static cmd_attributes parse_prefix(const string* str, int attribs)
+{
+	if (str->size == 3 && (attribs & ATTRIBUTE_PIN) == 0
+		&& strcmp(str->buf, "pin") == 0)
+		return ATTRIBUTE_PIN;
+	if (str->size == 5 && (attribs & ATTRIBUTE_CACHE) == 0
+		&& strcmp(str->buf, "cache") == 0)
+		return ATTRIBUTE_CACHE;
+	return ATTRIBUTE_NONE;
+}
+
+// operator listy potokow, przesuwa linie za niego
+static list_op parse_list_op(const char** in)
+{
+	const char* tmp = *in;
+	if (tmp[0] == ';') {
+		*in = tmp + 1;
+		return LIST_SEQ;
+	}
+	if (tmp[0] == '&' && tmp[1] == '&') {
+		*in = tmp + 2;
+		return LIST_AND;
+	}
+	if (tmp[0] == '|' && tmp[1] == '|') {
+		*in = tmp + 2;
+		return LIST_OR;
+	}
+	return LIST_END;
+}
+
+static const char* list_op_str(list_op op)
+{
+	switch (op) {
+	case LIST_SEQ:
+		return ";";
+	case LIST_AND:
+		return "&&";
+	case LIST_OR:
+		return "||";
+	case LIST_END:
+		break;
+	}
+	return "";
+}
+
+void cleanup_vecs(vec_cmds* in1, vec_string* in2, string* in3, vec_flags* in4)
 {
 	string_deinit(in3);
 	vec_string_deinit(in2);
 	vec_cmds_deinit(in1);
+	vec_flags_deinit(in4);
+}
+
+// zakonczenie komendy, znaczniki slow zachowywane sa jedynie gdy ktores ze
+// slow wymaga rozwiniecia przy wykonaniu
+static shell_cmd cmd_finish(vec_string* out, vec_flags* flags)
+{
+	char* argv_needs_null = NULL;
+	vec_string_push(out, &argv_needs_null);
+	shell_cmd cmd = (shell_cmd) {
+		.argc  = out->size - 1,
+		.argv  = out->buf,
+		.flags = NULL,
+	};
+	for (size_t i = 0; i < flags->size && cmd.flags == NULL; ++i) {
+		if (flags->buf[i] != WORD_PLAIN)
+			cmd.flags = flags->buf;
+	}
+	if (cmd.flags == NULL)
+		vec_flags_deinit(flags);
+	return cmd;
 }
 // glowna funkcja do przetworzenia linii
 int parse_line(parser_result* res, const char* line)
 {
 	vec_string out = vec_string_init();
 	vec_cmds cmds  = vec_cmds_init();
+	vec_flags wflags = vec_flags_init();
 	int isasync    = 0;
 	int redirstate = 0;
 	int attribs    = 0;
+	int prefix     = 0;
 	char* stdinf   = NULL;
 	char* stdoutf  = NULL;
+	list_op op     = LIST_END;
 	for (;;) {
 		line = skip_ws(line);
+		if ((op = parse_list_op(&line)) != LIST_END)
+			break;
 		if (line[0] == '&') {
 			line = skip_ws(line + 1);
 			if (line[0] != '\0') {
 				fprintf(stderr, "%s: Expected nothing after &\n", progname);
 				vec_string_deinit(&out);
 				vec_cmds_deinit(&cmds);
+				vec_flags_deinit(&wflags);
 				return 1;
 			}
 			isasync = 1;
@@ -141,20 +251,20 @@ int parse_line(parser_result* res, const char* line)
 
 		if (redi != ATTRIBUTE_NONE && redi != ATTRIBUTE_STDIN
 			&& (redi & ATTRIBUTE_STDOUT) == 0) {
-			char* argv_needs_null = NULL;
-			vec_string_push(&out, &argv_needs_null);
-			shell_cmd tmp
-				= (shell_cmd) { .argc = out.size - 1, .argv = out.buf };
+			shell_cmd tmp = cmd_finish(&out, &wflags);
 			vec_cmds_push(&cmds, &tmp);
-			out = vec_string_init();
+			out    = vec_string_init();
+			wflags = vec_flags_init();
 		}
 
-		string str = string_init();
-		int res    = push_word(&str, &line);
+		string str       = string_init();
+		const char* word = line;
+		int glob;
+		int res = push_word(&str, &line, &glob);
 
 		if (res == END_OF_LINE && out.size == 0 && cmds.size == 0
 			&& str.size == 0) {
-			cleanup_vecs(&cmds, &out, &str);
+			cleanup_vecs(&cmds, &out, &str, &wflags);
 			return 1;
 		}
 		if (redirstate == 1 && redi == ATTRIBUTE_NONE && res != END_OF_LINE) {
@@ -167,7 +277,7 @@ int parse_line(parser_result* res, const char* line)
 					"%s: Only symbols expected after stdout redirection\n",
 					progname);
 			}
-			cleanup_vecs(&cmds, &out, &str);
+			cleanup_vecs(&cmds, &out, &str, &wflags);
 			return 1;
 
 		} else if (redi == ATTRIBUTE_STDIN) {
@@ -175,16 +285,16 @@ int parse_line(parser_result* res, const char* line)
 			if (str.size == 0) {
 				fprintf(
 					stderr, "%s: Missing file to redirect stdin\n", progname);
-				cleanup_vecs(&cmds, &out, &str);
+				cleanup_vecs(&cmds, &out, &str, &wflags);
 				return 1;
 			}
 			stdinf = str.buf;
 			line   = skip_ws(line);
-			if (line[0] == '&') {
+			if (line[0] == '&' && line[1] != '&') {
 				line = skip_ws(line + 1);
 				if (line[0] != '\0') {
 					fprintf(stderr, "%s: Expected nothing after &\n", progname);
-					cleanup_vecs(&cmds, &out, &str);
+					cleanup_vecs(&cmds, &out, &str, &wflags);
 					return 1;
 				}
 				isasync = 1;
@@ -194,14 +304,29 @@ int parse_line(parser_result* res, const char* line)
 			if (str.size == 0) {
 				fprintf(
 					stderr, "%s: Missing file to redirect stdin\n", progname);
-				cleanup_vecs(&cmds, &out, &str);
+				cleanup_vecs(&cmds, &out, &str, &wflags);
 				return 1;
 			}
 			attribs |= redi;
 			stdoutf    = str.buf;
 			redirstate = 1;
-		} else if (str.size != 0)
+		} else if (out.size == 0 && cmds.size == 0
+			&& (prefix = parse_prefix(&str, attribs)) != ATTRIBUTE_NONE) {
+			attribs |= prefix;
+			string_deinit(&str);
+		} else if (str.size != 0) {
+			// wzorce oraz slowa z $ zapisywane sa w postaci z backslashami,
+			// wzorzec rozwijany jest dopiero przy wykonaniu, gdy pliki moga
+			// juz istniec, a $ po backslashu nie jest zmienna petli
+			unsigned char flag = WORD_PLAIN;
+			if (glob || strchr(str.buf, '$') != NULL) {
+				string_deinit(&str);
+				str  = glob_pattern(word, line);
+				flag = WORD_ESCAPED | (glob ? WORD_GLOB : 0);
+			}
 			vec_string_push(&out, &str.buf);
+			vec_flags_push(&wflags, &flag);
+		}
 
 		if (res == WHITESPACE) {
 			continue;
@@ -212,12 +337,27 @@ int parse_line(parser_result* res, const char* line)
 		}
 	}
 
-	char* argv_needs_null = NULL;
-	vec_string_push(&out, &argv_needs_null);
-	shell_cmd tmp = (shell_cmd) {
-		.argc = out.size - 1,
-		.argv = out.buf,
-	};
+	if (op != LIST_END && out.size == 0
+		&& (attribs & (ATTRIBUTE_PIN | ATTRIBUTE_CACHE)) == 0) {
+		fprintf(stderr, "%s: Unexpected %s\n", progname, list_op_str(op));
+		free(stdinf);
+		free(stdoutf);
+		vec_string_deinit(&out);
+		vec_cmds_deinit(&cmds);
+		vec_flags_deinit(&wflags);
+		return 1;
+	}
+	if ((attribs & (ATTRIBUTE_PIN | ATTRIBUTE_CACHE)) != 0 && out.size == 0
+		&& cmds.size == 0) {
+		fprintf(stderr, "%s: Expected command after prefix\n", progname);
+		free(stdinf);
+		free(stdoutf);
+		vec_string_deinit(&out);
+		vec_cmds_deinit(&cmds);
+		vec_flags_deinit(&wflags);
+		return 1;
+	}
+	shell_cmd tmp = cmd_finish(&out, &wflags);
 	vec_cmds_push(&cmds, &tmp);
 	res->is_async         = isasync;
 	res->cmdlist.size     = cmds.size;
@@ -225,8 +365,126 @@ int parse_line(parser_result* res, const char* line)
 	res->stdinfile        = stdinf;
 	res->stdoutfile       = stdoutf;
 	res->attrib           = attribs;
+	res->next_op          = op;
+	res->next             = NULL;
+	if (op == LIST_END)
+		return 0;
+
+	// reszta listy parsowana jest od razu, w tym samym przebiegu
+	line = skip_ws(line);
+	if (line[0] == '\0' || line[0] == '#') {
+		res->next_op = LIST_END;
+		if (op == LIST_SEQ)
+			return 0;
+		fprintf(stderr, "%s: Expected command after %s\n", progname,
+			list_op_str(op));
+		parser_result_dealloc(res);
+		return 1;
+	}
+	res->next = malloc(sizeof(parser_result));
+	if (res->next == NULL) {
+		fprintf(stderr, "Critical error: Malloc failure\n");
+		exit(1);
+	}
+	if (parse_line(res->next, line)) {
+		free(res->next);
+		res->next = NULL;
+		parser_result_dealloc(res);
+		return 1;
+	}
 	return 0;
 }
+
+parser_result* parser_result_next(const parser_result* it, int status)
+{
+	for (;;) {
+		list_op op = it->next_op;
+		it         = it->next;
+		if (it == NULL)
+			return NULL;
+		if (op == LIST_SEQ || (op == LIST_AND && status == 0)
+			|| (op == LIST_OR && status != 0))
+			return (parser_result*)it;
+	}
+}
+// usuniecie backslashy z postaci zapisanej przez glob_pattern
+static char* word_unescape(const char* word)
+{
+	char* out = malloc(strlen(word) + 1);
+	if (out == NULL) {
+		fprintf(stderr, "Critical error: Malloc failure\n");
+		exit(1);
+	}
+	char* tmp = out;
+	for (; *word != '\0'; ++word) {
+		if (*word == '\\' && word[1] != '\0')
+			++word;
+		*tmp++ = *word;
+	}
+	*tmp = '\0';
+	return out;
+}
+
+char** word_expand(const char* word, int flags, size_t* count)
+{
+	if ((flags & WORD_GLOB) != 0) {
+		char** names = wildcard_expand(word, count);
+		if (names != NULL)
+			return names;
+	}
+	// bez dopasowan slowo pozostaje bez zmian
+	char** out = malloc(2 * sizeof(char*));
+	if (out == NULL) {
+		fprintf(stderr, "Critical error: Malloc failure\n");
+		exit(1);
+	}
+	out[0] = (flags & WORD_ESCAPED) != 0 ? word_unescape(word) : strdup(word);
+	out[1] = NULL;
+	*count = 1;
+	return out;
+}
+
+bool parser_result_expand(parser_result* out, const parser_result* in)
+{
+	int i = 0;
+	while (i < in->cmdlist.size && in->cmdlist.commands[i].flags == NULL)
+		++i;
+	if (i == in->cmdlist.size)
+		return false;
+	*out                  = *in;
+	out->next             = NULL;
+	out->stdinfile        = in->stdinfile != NULL ? strdup(in->stdinfile) : NULL;
+	out->stdoutfile       = in->stdoutfile != NULL ? strdup(in->stdoutfile) : NULL;
+	out->cmdlist.commands = malloc(in->cmdlist.size * sizeof(shell_cmd));
+	if (out->cmdlist.commands == NULL) {
+		fprintf(stderr, "Critical error: Malloc failure\n");
+		exit(1);
+	}
+	for (i = 0; i < in->cmdlist.size; ++i) {
+		const shell_cmd* cmd = &in->cmdlist.commands[i];
+		vec_string argv      = vec_string_init();
+		vec_string_reserve(&argv, cmd->argc + 1);
+		for (int j = 0; j < cmd->argc; ++j) {
+			int flags = cmd->flags != NULL ? cmd->flags[j] : WORD_PLAIN;
+			size_t count;
+			char** words = word_expand(cmd->argv[j], flags, &count);
+			// jednorazowe powiekszenie argv, +1 na konczacy NULL
+			vec_string_reserve(&argv, argv.size + count + cmd->argc - j + 1);
+			for (size_t k = 0; k < count; ++k)
+				vec_string_push(&argv, &words[k]);
+			free(words);
+		}
+		char* argv_needs_null = NULL;
+		vec_string_push(&argv, &argv_needs_null);
+		out->cmdlist.commands[i] = (shell_cmd) {
+			.argc  = argv.size - 1,
+			.argv  = argv.buf,
+			.flags = NULL,
+		};
+	}
+	return true;
+}
+
 // dealokacja pamieci wyniku parsowania
 void parser_result_dealloc(parser_result* in)
 {
@@ -235,8 +493,65 @@ void parser_result_dealloc(parser_result* in)
 			free(in->cmdlist.commands[i].argv[j]);
 		}
 		free(in->cmdlist.commands[i].argv);
+		free(in->cmdlist.commands[i].flags);
 	}
 	free(in->cmdlist.commands);
 	free(in->stdinfile);
 	free(in->stdoutfile);
+	if (in->next != NULL) {
+		parser_result_dealloc(in->next);
+		free(in->next);
+	}
+}
+
+// wydzielenie segmentu do srednika lub komentarza z pominieciem znakow w
+// cudzyslowie oraz poprzedzonych backslashem
+char* next_segment(const char** line)
+{
+	const char* start = *line;
+	const char* tmp   = start;
+	if (*tmp == '\0')
+		return NULL;
+	int state_dq    = 0;
+	int state_bcksl = 0;
+	for (char c; (c = *tmp) != '\0'; ++tmp) {
+		if (state_bcksl == 1) {
+			state_bcksl = 0;
+		} else if (c == '\\' && state_dq == 0) {
+			state_bcksl = 1;
+		} else if (c == '"') {
+			state_dq = !state_dq;
+		} else if (state_dq == 0 && c == '#') {
+			*line = tmp + strlen(tmp);
+			return strndup(start, tmp - start);
+		} else if (state_dq == 0 && c == ';') {
+			*line = tmp + 1;
+			return strndup(start, tmp - start);
+		}
+	}
+	*line = tmp;
+	return strndup(start, tmp - start);
+}
+
+keyword parse_keyword(const char** segment)
+{
+	static const struct {
+		const char* name;
+		keyword kw;
+	} keywords[] = {
+		{ "for", KEYWORD_FOR },
+		{ "while", KEYWORD_WHILE },
+		{ "done", KEYWORD_DONE },
+		{ "do", KEYWORD_DO },
+	};
+	const char* tmp = skip_ws(*segment);
+	for (size_t i = 0; i < sizeof keywords / sizeof *keywords; ++i) {
+		size_t len = strlen(keywords[i].name);
+		if (strncmp(tmp, keywords[i].name, len) == 0
+			&& (tmp[len] == '\0' || isspace(tmp[len]))) {
+			*segment = skip_ws(tmp + len);
+			return keywords[i].kw;
+		}
+	}
+	return KEYWORD_NONE;
 }
@@ -1,5 +1,7 @@
 #ifndef PARSER_H
 #define PARSER_H
+#include <stdbool.h>
+#include <stddef.h>
 
 // wartosci atrybutow do obslugi plikow
 typedef enum cmd_attributes {
@@ -10,13 +12,28 @@ typedef enum cmd_attributes {
 	ATTRIBUTE_PIPE   = 8,
 	ATTRIBUTE_STDOUT = 16,
 	ATTRIBUTE_STDERR = 32,
-	ATTRIBUTE_STDIN  = 32
+	ATTRIBUTE_STDIN  = 32,
+	// potok poprzedzony slowem pin, etapy przypinane do rdzeni
+	ATTRIBUTE_PIN    = 64,
+	// potok poprzedzony slowem cache, wynik zapamietywany
+	ATTRIBUTE_CACHE  = 128
 } cmd_attributes;
 
+// znaczniki slow komendy rozwijanych dopiero przy wykonaniu
+typedef enum word_flags {
+	WORD_PLAIN   = 0,
+	// slowo zapisane z backslashem przed znakami traktowanymi doslownie
+	WORD_ESCAPED = 1,
+	// slowo zawiera niecytowane znaki wzorca * ? [
+	WORD_GLOB    = 2,
+} word_flags;
+
 // pojedyncza komenda
 typedef struct shell_cmd {
 	int argc;
 	char** argv;
+	// znaczniki kolejnych slow, NULL gdy wszystkie slowa sa WORD_PLAIN
+	unsigned char* flags;
 } shell_cmd;
 
 // lista komend
@@ -25,17 +42,58 @@ typedef struct cmd_list {
 	int size;
 } cmd_list;
 
+// polaczenie potoku z kolejnym potokiem listy
+typedef enum list_op {
+	LIST_END,
+	// ; - kolejny potok wykonywany zawsze
+	LIST_SEQ,
+	// && - kolejny potok wykonywany gdy biezacy zakonczyl sie kodem 0
+	LIST_AND,
+	// || - kolejny potok wykonywany gdy biezacy zakonczyl sie bledem
+	LIST_OR,
+} list_op;
+
 // Przetworzona wczytana linia, podzielona na odpowiednio komendy i ich
-// argumenty, pliki do wejscia oraz wyjscia + flaga async
+// argumenty, pliki do wejscia oraz wyjscia + flaga async. Linia zawierajaca
+// ; && lub || tworzy liste potokow polaczonych polem next.
 typedef struct parser_result {
 	cmd_list cmdlist;
 	char* stdinfile;
 	char* stdoutfile;
 	cmd_attributes attrib;
 	int is_async;
+	list_op next_op;
+	struct parser_result* next;
 } parser_result;
 
+// slowa kluczowe petli rozpoznawane na poczatku segmentu linii
+typedef enum keyword {
+	KEYWORD_NONE,
+	KEYWORD_FOR,
+	KEYWORD_WHILE,
+	KEYWORD_DO,
+	KEYWORD_DONE,
+} keyword;
+
 int parse_line(parser_result* res, const char* line);
 void parser_result_dealloc(parser_result* res);
 
+// Rozwiniecie slowa przy wykonaniu. Wzorzec zamieniany jest na posortowana
+// liste pasujacych plikow, w pozostalych przypadkach usuwane sa jedynie
+// backslashe. Zwraca tablice zakonczona NULLem, zwalniana przez wywolujacego.
+char** word_expand(const char* word, int flags, size_t* count);
+// Rozwiniecie slow potoku oznaczonych przy parsowaniu. Zwraca false jesli
+// potok nie zawiera takich slow, wtedy out nie jest uzupelniany. Wynik
+// zwalniany jest przez parser_result_dealloc.
+bool parser_result_expand(parser_result* out, const parser_result* in);
+
+// kolejny potok listy do wykonania po potoku it zakonczonym kodem status,
+// potoki pominiete przez && oraz || nie sa zwracane
+parser_result* parser_result_next(const parser_result* it, int status);
+
+// kolejny segment linii zakonczony srednikiem, NULL na koncu linii
+char* next_segment(const char** line);
+// rozpoznanie slowa kluczowego, przy trafieniu przesuwa segment za nie
+keyword parse_keyword(const char** segment);
+
 #endif
@@ -0,0 +1,210 @@
+#define _GNU_SOURCE
+#include "loop.h"
+#include "server.h"
+#include "shell.h"
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t server_stop;
+
+static void server_sig_handler(int id)
+{
+	(void)id;
+	server_stop = 1;
+}
+
+// wczytanie dokladnie len bajtow z gniazda
+static int read_full(int fd, void* buf, size_t len)
+{
+	char* tmp = buf;
+	while (len > 0) {
+		ssize_t n = read(fd, tmp, len);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		tmp += n;
+		len -= n;
+	}
+	return 0;
+}
+
+// odebranie naglowka zapytania razem z deskryptorami stdio klienta
+static int recv_request(int conn, server_request* req, int fds[3])
+{
+	union {
+		char buf[CMSG_SPACE(sizeof(int[3]))];
+		struct cmsghdr align;
+	} ctrl;
+	struct iovec iov  = { .iov_base = req, .iov_len = sizeof *req };
+	struct msghdr msg = {
+		.msg_iov        = &iov,
+		.msg_iovlen     = 1,
+		.msg_control    = ctrl.buf,
+		.msg_controllen = sizeof ctrl.buf,
+	};
+	ssize_t n;
+	while ((n = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC)) == -1 && errno == EINTR)
+		;
+	if (n <= 0 || (msg.msg_flags & MSG_CTRUNC) != 0)
+		return -1;
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET
+		|| cmsg->cmsg_type != SCM_RIGHTS
+		|| cmsg->cmsg_len != CMSG_LEN(sizeof(int[3])))
+		return -1;
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(int[3]));
+	// reszta naglowka mogla nie przyjsc w pierwszym fragmencie
+	if ((size_t)n < sizeof *req
+		&& read_full(conn, (char*)req + n, sizeof *req - n) == -1)
+		return -1;
+	return 0;
+}
+
+// klient musi byc uruchomiony przez tego samego uzytkownika co serwer
+static bool peer_allowed(int conn)
+{
+	struct ucred cred;
+	socklen_t len = sizeof cred;
+	if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) == -1) {
+		perror(progname);
+		return false;
+	}
+	if (cred.uid != geteuid()) {
+		fprintf(stderr,
+			"%s: Rejected client with uid %u\n",
+			progname,
+			(unsigned)cred.uid);
+		return false;
+	}
+	return true;
+}
+
+// obsluga pojedynczego klienta w procesie potomnym, nie wraca
+static void serve_client(int conn)
+{
+	server_request req;
+	int fds[3];
+	if (recv_request(conn, &req, fds) == -1) {
+		fprintf(stderr, "%s: Malformed client request\n", progname);
+		_exit(1);
+	}
+	if (req.cwd_len >= PATH_MAX || req.body_len > SERVER_MAX_BODY) {
+		fprintf(stderr, "%s: Client request too large\n", progname);
+		_exit(1);
+	}
+	char* cwd  = malloc(req.cwd_len + 1);
+	char* body = malloc(req.body_len + 1);
+	if (cwd == NULL || body == NULL) {
+		fprintf(stderr, "Critical error: Malloc failure\n");
+		_exit(1);
+	}
+	if (read_full(conn, cwd, req.cwd_len) == -1
+		|| read_full(conn, body, req.body_len) == -1) {
+		fprintf(stderr, "%s: Client disconnected\n", progname);
+		_exit(1);
+	}
+	cwd[req.cwd_len]   = '\0';
+	body[req.body_len] = '\0';
+
+	// od tej pory stdio procesu to stdio klienta
+	for (int i = 0; i < 3; ++i) {
+		dup2(fds[i], i);
+		if (fds[i] > STDERR_FILENO)
+			close(fds[i]);
+	}
+	if (chdir(cwd) == -1)
+		fprintf(stderr, "%s: cd %s: %s\n", progname, cwd, strerror(errno));
+
+	int status   = 0;
+	bool running = true;
+	for (char* line = body; running && line != NULL;) {
+		char* nl = strchr(line, '\n');
+		if (nl != NULL)
+			*nl = '\0';
+		int res = run_line(line, &running);
+		if (res != -1)
+			status = res;
+		line = nl != NULL ? nl + 1 : NULL;
+	}
+	if (loop_eof())
+		status = 1;
+	fflush(stdout);
+	fflush(stderr);
+
+	int32_t out = status;
+	write(conn, &out, sizeof out);
+	_exit(status);
+}
+
+// petla serwera, kazde polaczenie obslugiwane jest w osobnym procesie, dzieki
+// czemu klienci wykonywani sa rownolegle
+int server_run(const char* path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	if (strlen(path) >= sizeof addr.sun_path) {
+		fprintf(stderr, "%s: %s: Socket path too long\n", progname, path);
+		return 1;
+	}
+	strcpy(addr.sun_path, path);
+
+	int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (sock == -1) {
+		perror(progname);
+		return 1;
+	}
+	// usuwamy jedynie pozostalosc po poprzednim serwerze, nie zwykly plik
+	struct stat st;
+	if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+		unlink(path);
+	// gniazdo wykonuje dowolne komendy, wiec dostep ma jedynie wlasciciel
+	mode_t old_mask = umask(077);
+	int bound       = bind(sock, (struct sockaddr*)&addr, sizeof addr);
+	umask(old_mask);
+	if (bound == -1 || listen(sock, SOMAXCONN) == -1) {
+		fprintf(stderr, "%s: %s: %s\n", progname, path, strerror(errno));
+		close(sock);
+		return 1;
+	}
+
+	// bez SA_RESTART, aby accept zostal przerwany przez sygnal
+	struct sigaction sa = { .sa_handler = server_sig_handler };
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGINT, &sa, NULL);
+
+	while (!server_stop) {
+		int conn = accept4(sock, NULL, NULL, SOCK_CLOEXEC);
+		if (conn == -1) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			perror(progname);
+			break;
+		}
+		if (!peer_allowed(conn)) {
+			close(conn);
+			continue;
+		}
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(sock);
+			signal(SIGTERM, SIG_DFL);
+			signal(SIGINT, SIG_DFL);
+			serve_client(conn);
+		} else if (pid == -1) {
+			perror(progname);
+		}
+		close(conn);
+	}
+	close(sock);
+	unlink(path);
+	return 0;
+}
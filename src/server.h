@@ -0,0 +1,18 @@
+#ifndef SERVER_H
+#define SERVER_H
+#include <stdint.h>
+
+// maksymalny rozmiar skryptu przyjmowanego przez serwer
+#define SERVER_MAX_BODY (16u << 20)
+
+// naglowek zapytania klienta, wysylany razem z deskryptorami stdin, stdout
+// oraz stderr (SCM_RIGHTS). Po nim nastepuje katalog roboczy klienta oraz
+// tresc skryptu. Serwer odpowiada kodem wyjscia jako int32_t.
+typedef struct server_request {
+	uint32_t cwd_len;
+	uint32_t body_len;
+} server_request;
+
+int server_run(const char* path);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef SHELL_H
+#define SHELL_H
+#include "parser.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+
+extern const char* progname;
+extern atomic_int sigint_var, sigterm_var;
+
+// wykonanie potoku, zwraca kod wyjscia ostatniej komendy
+int piping(parser_result* in);
+
+// wykonanie pojedynczego potoku wraz z obsluga komend wbudowanych
+int run_pipeline(parser_result* pars, bool* running);
+
+// wykonanie przetworzonej linii, czyli listy potokow
+int run_parsed(parser_result* pars, bool* running);
+
+// przetworzenie i wykonanie linii, -1 jesli linia nie zawierala komendy
+int run_line(const char* line, bool* running);
+
+#endif
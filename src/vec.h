@@ -35,9 +35,18 @@
 		if (vec->size + 1 == vec->cap) {                                    \
 			const size_t newcap = vec->cap + vec->cap / 2;                  \
 			vec->buf            = realloc(vec->buf, newcap * sizeof(type)); \
+			vec->cap            = newcap;                                   \
 		}                                                                   \
 		memcpy(&vec->buf[vec->size], data, sizeof(type));                   \
 		vec->size++;                                                        \
+	}                                                                       \
+                                                                            \
+	static inline void name##_reserve(name* vec, size_t cap)                \
+	{                                                                       \
+		if (cap > vec->cap) {                                               \
+			vec->buf = realloc(vec->buf, cap * sizeof(type));               \
+			vec->cap = cap;                                                 \
+		}                                                                   \
 	}
 
 #endif
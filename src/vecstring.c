@@ -18,6 +18,7 @@ string string_init()
 void string_deinit(string* str)
 {
 	free(str->buf);
+	str->buf  = NULL;
 	str->cap  = 0;
 	str->size = 0;
 }
@@ -27,6 +28,7 @@ void string_push(string* str, char c)
 	if (str->size + 2 == str->cap) {
 		const size_t newcap = str->cap + str->cap / 2;
 		str->buf            = realloc(str->buf, newcap);
+		str->cap            = newcap;
 	}
 	str->buf[str->size++] = c;
 	str->buf[str->size]   = '\0';
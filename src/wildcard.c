@@ -0,0 +1,457 @@
+#define _GNU_SOURCE
+#include "wildcard.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// rozmiar bufora getdents64, duze porcje ograniczaja liczbe wywolan systemowych
+#define DENTS_BUF_SIZE (256 * 1024)
+
+struct linux_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+// pozycja w liscie katalogu, nazwy przechowywane sa w jednym buforze
+typedef struct dir_entry {
+	size_t name_off;
+	size_t name_len;
+	unsigned char type;
+} dir_entry;
+
+typedef struct dir_listing {
+	char* path;
+	dev_t dev;
+	ino_t ino;
+	struct timespec mtime;
+	char* names;
+	size_t names_len;
+	size_t names_cap;
+	dir_entry* entries;
+	size_t count;
+	size_t cap;
+} dir_listing;
+
+enum token_kind {
+	TOKEN_CHAR,
+	TOKEN_ANY,
+	TOKEN_STAR,
+	TOKEN_CLASS,
+};
+
+typedef struct pattern_token {
+	enum token_kind kind;
+	unsigned char c;
+	// zbior znakow dla [...], bit na kazdy bajt
+	unsigned char set[32];
+} pattern_token;
+
+// skompilowany wzorzec pojedynczego skladnika sciezki
+typedef struct pattern {
+	pattern_token* tokens;
+	size_t len;
+	// minimalna dlugosc pasujacej nazwy
+	size_t min_len;
+	// staly przyrostek po ostatniej gwiazdce, sprawdzany przed dopasowaniem
+	char* suffix;
+	size_t suffix_len;
+	bool leading_dot;
+} pattern;
+
+typedef struct name_list {
+	char** buf;
+	size_t size;
+	size_t cap;
+} name_list;
+
+static dir_listing* cache = NULL;
+static size_t cache_len   = 0;
+static size_t cache_cap   = 0;
+
+static void* xrealloc(void* ptr, size_t size)
+{
+	ptr = realloc(ptr, size);
+	if (ptr == NULL) {
+		fprintf(stderr, "Critical error: Malloc failure\n");
+		exit(1);
+	}
+	return ptr;
+}
+
+static void names_push(name_list* out, char* name)
+{
+	if (out->size + 1 >= out->cap) {
+		out->cap = out->cap == 0 ? 64 : out->cap * 2;
+		out->buf = xrealloc(out->buf, out->cap * sizeof(char*));
+	}
+	out->buf[out->size++] = name;
+}
+
+static bool is_magic(char c)
+{
+	return c == '*' || c == '?' || c == '[';
+}
+
+static bool has_magic(const char* comp, size_t len)
+{
+	for (size_t i = 0; i < len; ++i) {
+		if (comp[i] == '\\')
+			++i;
+		else if (is_magic(comp[i]))
+			return true;
+	}
+	return false;
+}
+
+// usuniecie backslashy ze skladnika bez znakow wzorca
+static size_t unescape(char* dst, const char* src, size_t len)
+{
+	size_t out = 0;
+	for (size_t i = 0; i < len; ++i) {
+		if (src[i] == '\\' && i + 1 < len)
+			++i;
+		dst[out++] = src[i];
+	}
+	return out;
+}
+
+static void set_add(unsigned char* set, unsigned char c)
+{
+	set[c / 8] |= 1u << (c % 8);
+}
+
+// kompilacja [...], zwraca dlugosc klasy lub 0 jesli brak zamykajacego ]
+static size_t compile_class(pattern_token* tok, const char* src, size_t len)
+{
+	size_t i    = 1;
+	bool negate = false;
+	if (i < len && (src[i] == '!' || src[i] == '^')) {
+		negate = true;
+		++i;
+	}
+	memset(tok->set, 0, sizeof tok->set);
+	size_t first = i;
+	for (; i < len && (src[i] != ']' || i == first); ++i) {
+		unsigned char lo = src[i];
+		if (lo == '\\' && i + 1 < len)
+			lo = src[++i];
+		unsigned char hi = lo;
+		if (i + 2 < len && src[i + 1] == '-' && src[i + 2] != ']') {
+			i += 2;
+			hi = src[i];
+			if (hi == '\\' && i + 1 < len)
+				hi = src[++i];
+		}
+		for (unsigned c = lo; c <= hi; ++c)
+			set_add(tok->set, c);
+	}
+	if (i >= len)
+		return 0;
+	if (negate) {
+		for (size_t j = 0; j < sizeof tok->set; ++j)
+			tok->set[j] = ~tok->set[j];
+	}
+	tok->kind = TOKEN_CLASS;
+	return i + 1;
+}
+
+static void pattern_compile(pattern* p, const char* src, size_t len)
+{
+	p->tokens  = xrealloc(NULL, (len + 1) * sizeof(pattern_token));
+	p->len     = 0;
+	p->min_len = 0;
+	for (size_t i = 0; i < len;) {
+		pattern_token* tok = &p->tokens[p->len];
+		size_t used        = 1;
+		if (src[i] == '*') {
+			tok->kind = TOKEN_STAR;
+			// kolejne gwiazdki sa rownowazne jednej
+			if (p->len > 0 && p->tokens[p->len - 1].kind == TOKEN_STAR) {
+				++i;
+				continue;
+			}
+		} else if (src[i] == '?') {
+			tok->kind = TOKEN_ANY;
+		} else if (src[i] != '['
+			|| (used = compile_class(tok, src + i, len - i)) == 0) {
+			// niedomkniety [ traktowany jest doslownie
+			used = 1;
+			if (src[i] == '\\' && i + 1 < len)
+				used = 2;
+			tok->kind = TOKEN_CHAR;
+			tok->c    = src[i + used - 1];
+		}
+		if (tok->kind != TOKEN_STAR)
+			p->min_len++;
+		p->len++;
+		i += used;
+	}
+	p->leading_dot = p->len > 0 && p->tokens[0].kind == TOKEN_CHAR
+		&& p->tokens[0].c == '.';
+
+	size_t start = p->len;
+	while (start > 0 && p->tokens[start - 1].kind == TOKEN_CHAR)
+		--start;
+	p->suffix_len = p->len - start;
+	p->suffix     = xrealloc(NULL, p->suffix_len + 1);
+	for (size_t i = 0; i < p->suffix_len; ++i)
+		p->suffix[i] = p->tokens[start + i].c;
+}
+
+static void pattern_free(pattern* p)
+{
+	free(p->tokens);
+	free(p->suffix);
+}
+
+static bool token_match(const pattern_token* tok, unsigned char c)
+{
+	switch (tok->kind) {
+	case TOKEN_CHAR:
+		return tok->c == c;
+	case TOKEN_ANY:
+		return true;
+	case TOKEN_CLASS:
+		return (tok->set[c / 8] >> (c % 8)) & 1;
+	case TOKEN_STAR:
+		break;
+	}
+	return false;
+}
+
+// dopasowanie z powrotem jedynie do ostatniej gwiazdki, czas liniowy wzgledem
+// dlugosci nazwy dla typowych wzorcow
+static bool pattern_match(const pattern* p, const char* name, size_t len)
+{
+	if (len < p->min_len)
+		return false;
+	if (name[0] == '.' && !p->leading_dot)
+		return false;
+	if (p->suffix_len > 0
+		&& memcmp(name + len - p->suffix_len, p->suffix, p->suffix_len) != 0)
+		return false;
+	size_t ti = 0, si = 0;
+	size_t star_t = SIZE_MAX, star_s = 0;
+	while (si < len) {
+		if (ti < p->len && p->tokens[ti].kind == TOKEN_STAR) {
+			star_t = ti++;
+			star_s = si;
+		} else if (ti < p->len && token_match(&p->tokens[ti], name[si])) {
+			++ti;
+			++si;
+		} else if (star_t != SIZE_MAX) {
+			ti = star_t + 1;
+			si = ++star_s;
+		} else {
+			return false;
+		}
+	}
+	while (ti < p->len && p->tokens[ti].kind == TOKEN_STAR)
+		++ti;
+	return ti == p->len;
+}
+
+static void listing_clear(dir_listing* dir)
+{
+	dir->names_len = 0;
+	dir->count     = 0;
+}
+
+static void listing_push(dir_listing* dir, const char* name, unsigned char type)
+{
+	size_t len = strlen(name);
+	if (dir->names_len + len + 1 > dir->names_cap) {
+		dir->names_cap = dir->names_cap == 0 ? 4096 : dir->names_cap * 2;
+		while (dir->names_len + len + 1 > dir->names_cap)
+			dir->names_cap *= 2;
+		dir->names = xrealloc(dir->names, dir->names_cap);
+	}
+	if (dir->count == dir->cap) {
+		dir->cap     = dir->cap == 0 ? 64 : dir->cap * 2;
+		dir->entries = xrealloc(dir->entries, dir->cap * sizeof(dir_entry));
+	}
+	memcpy(dir->names + dir->names_len, name, len + 1);
+	dir->entries[dir->count++] = (dir_entry) {
+		.name_off = dir->names_len,
+		.name_len = len,
+		.type     = type,
+	};
+	dir->names_len += len + 1;
+}
+
+// odczyt katalogu duzymi porcjami getdents64 z pominieciem . oraz ..
+static bool listing_read(dir_listing* dir)
+{
+	int fd = open(dir->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1)
+		return false;
+	char* buf = xrealloc(NULL, DENTS_BUF_SIZE);
+	listing_clear(dir);
+	long n;
+	while ((n = syscall(SYS_getdents64, fd, buf, DENTS_BUF_SIZE)) > 0) {
+		for (long off = 0; off < n;) {
+			struct linux_dirent64* d = (struct linux_dirent64*)(buf + off);
+			off += d->d_reclen;
+			if (d->d_name[0] == '.'
+				&& (d->d_name[1] == '\0'
+					|| (d->d_name[1] == '.' && d->d_name[2] == '\0')))
+				continue;
+			listing_push(dir, d->d_name, d->d_type);
+		}
+	}
+	free(buf);
+	close(fd);
+	return n == 0;
+}
+
+// lista katalogu z pamieci podrecznej, odswiezana po zmianie mtime
+static dir_listing* listing_get(const char* path)
+{
+	struct stat st;
+	if (stat(path, &st) == -1 || !S_ISDIR(st.st_mode))
+		return NULL;
+	dir_listing* dir = NULL;
+	for (size_t i = 0; i < cache_len; ++i) {
+		if (strcmp(cache[i].path, path) == 0) {
+			dir = &cache[i];
+			break;
+		}
+	}
+	if (dir != NULL && dir->dev == st.st_dev && dir->ino == st.st_ino
+		&& dir->mtime.tv_sec == st.st_mtim.tv_sec
+		&& dir->mtime.tv_nsec == st.st_mtim.tv_nsec)
+		return dir;
+	if (dir == NULL) {
+		if (cache_len == cache_cap) {
+			cache_cap = cache_cap == 0 ? 8 : cache_cap * 2;
+			cache     = xrealloc(cache, cache_cap * sizeof(dir_listing));
+		}
+		dir       = &cache[cache_len++];
+		*dir      = (dir_listing) { .path = strdup(path) };
+	}
+	dir->dev   = st.st_dev;
+	dir->ino   = st.st_ino;
+	dir->mtime = st.st_mtim;
+	if (!listing_read(dir)) {
+		// nieudany odczyt nie moze zostac uznany za aktualna liste
+		dir->mtime.tv_nsec = -1;
+		return NULL;
+	}
+	return dir;
+}
+
+static bool entry_is_dir(const char* base, const char* name, unsigned char type)
+{
+	if (type == DT_DIR)
+		return true;
+	if (type != DT_UNKNOWN && type != DT_LNK)
+		return false;
+	size_t blen = strlen(base);
+	char* path  = xrealloc(NULL, blen + strlen(name) + 1);
+	memcpy(path, base, blen);
+	strcpy(path + blen, name);
+	struct stat st;
+	bool res = stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+	free(path);
+	return res;
+}
+
+// base - dotychczas rozwinieta sciezka zakonczona '/' lub pusta,
+// rest - pozostale skladniki wzorca
+static void expand_path(const char* base, const char* rest, name_list* out)
+{
+	const char* slash = strchr(rest, '/');
+	size_t comp_len   = slash != NULL ? (size_t)(slash - rest) : strlen(rest);
+	const char* next  = slash;
+	while (next != NULL && *next == '/')
+		++next;
+	size_t blen = strlen(base);
+
+	if (!has_magic(rest, comp_len)) {
+		char* path = xrealloc(NULL, blen + comp_len + 2);
+		memcpy(path, base, blen);
+		size_t len = blen + unescape(path + blen, rest, comp_len);
+		if (slash != NULL && *next != '\0') {
+			path[len]     = '/';
+			path[len + 1] = '\0';
+			expand_path(path, next, out);
+			free(path);
+			return;
+		}
+		if (slash != NULL)
+			path[len++] = '/';
+		path[len] = '\0';
+		struct stat st;
+		if (lstat(path, &st) == 0)
+			names_push(out, path);
+		else
+			free(path);
+		return;
+	}
+
+	dir_listing* dir = listing_get(blen == 0 ? "." : base);
+	if (dir == NULL)
+		return;
+	pattern pat;
+	pattern_compile(&pat, rest, comp_len);
+	for (size_t i = 0; i < dir->count; ++i) {
+		dir_entry* ent   = &dir->entries[i];
+		const char* name = dir->names + ent->name_off;
+		if (!pattern_match(&pat, name, ent->name_len))
+			continue;
+		if (slash != NULL && !entry_is_dir(base, name, ent->type))
+			continue;
+		char* path = xrealloc(NULL, blen + ent->name_len + 2);
+		memcpy(path, base, blen);
+		memcpy(path + blen, name, ent->name_len);
+		size_t len = blen + ent->name_len;
+		if (slash != NULL)
+			path[len++] = '/';
+		path[len] = '\0';
+		if (slash != NULL && *next != '\0') {
+			// rekurencja moze przeniesc tablice cache, odswiezamy wskaznik
+			size_t idx = dir - cache;
+			expand_path(path, next, out);
+			dir = &cache[idx];
+			free(path);
+		} else {
+			names_push(out, path);
+		}
+	}
+	pattern_free(&pat);
+}
+
+static int name_cmp(const void* a, const void* b)
+{
+	return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+char** wildcard_expand(const char* pattern, size_t* count)
+{
+	name_list out = { 0 };
+	if (pattern[0] == '/') {
+		while (*pattern == '/')
+			++pattern;
+		expand_path("/", pattern, &out);
+	} else {
+		expand_path("", pattern, &out);
+	}
+	*count = out.size;
+	if (out.size == 0) {
+		free(out.buf);
+		return NULL;
+	}
+	qsort(out.buf, out.size, sizeof(char*), name_cmp);
+	out.buf[out.size] = NULL;
+	return out.buf;
+}
@@ -0,0 +1,12 @@
+#ifndef WILDCARD_H
+#define WILDCARD_H
+#include <stddef.h>
+
+// Rozwiniecie wzorca sciezki ze znakami * ? oraz [...], znaki poprzedzone
+// backslashem traktowane sa doslownie. Zwraca posortowana tablice nazw
+// zakonczona NULLem (zwalniana przez wywolujacego) lub NULL gdy nic nie
+// pasuje. Listy katalogow sa zapamietywane i odczytywane ponownie dopiero po
+// zmianie czasu modyfikacji katalogu.
+char** wildcard_expand(const char* pattern, size_t* count);
+
+#endif
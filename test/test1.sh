@@ -1,3 +1,3 @@
-#!./build/debug/shell.out
+#!./build/debug/grynszpan.out
 echo -e "bbb\naaa\nccc\naaa" >| /tmp/test.txt
 cat /tmp/test.txt | sort | uniq
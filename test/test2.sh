@@ -0,0 +1,10 @@
+#!./build/debug/grynszpan.out
+# wzorce rozwijane sa dopiero przy wykonaniu potoku, a nie przy parsowaniu
+# linii, oczekiwane wyjscie: a.log, a.log f1.log, a.log f1.log f2.log, ok
+mkdir -p /tmp/grynszpan-test2 && cd /tmp/grynszpan-test2 && rm -f *.log
+touch a.log && ls *.log
+for i in 1 2; do touch f$i.log; echo *.log; done
+ls nic*.log && echo zle || echo ok
+# przekierowania bez spacji, oczekiwane wyjscie: x
+echo x>|o.txt && cat<o.txt
+cd / && rm -r /tmp/grynszpan-test2